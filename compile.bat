@@ -1,4 +1,10 @@
 C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/shader.vert -o res/spir-v/vert.spv
 C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/shader.frag -o res/spir-v/frag.spv
 C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/circle.frag -o res/spir-v/circleFrag.spv
+C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/cull.comp -o res/spir-v/cull.spv
+C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/point.vert -o res/spir-v/pointVert.spv
+C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/point.frag -o res/spir-v/pointFrag.spv
+C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/splat.comp -o res/spir-v/splat.spv
+C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/density.vert -o res/spir-v/densityVert.spv
+C:/VulkanSDK/1.3.283.0/Bin/glslc.exe res/glsl/density.frag -o res/spir-v/densityFrag.spv
 pause
\ No newline at end of file
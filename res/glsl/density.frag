@@ -0,0 +1,14 @@
+#version 460 core
+
+layout (binding = 2, r32ui) uniform readonly uimage2D density;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	float count = float(imageLoad(density, ivec2(gl_FragCoord.xy)).r);
+
+	// The bodies' colour where there are any, brightening towards white as they pile up on a pixel
+	float heat = clamp(log2(count) / 8.0, 0.0, 1.0);
+	outColor = vec4(mix(vec3(0.4, 0.0, 1.0), vec3(1.0), heat), 1 - step(count, 0.0));
+}
@@ -0,0 +1,12 @@
+#version 460 core
+
+layout(location = 0) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	vec2 uv = gl_PointCoord * 2.0 - 1.0;
+	float uvDistance = uv.x * uv.x + uv.y * uv.y;
+	outColor = vec4(fragColor, 1 - step(1, uvDistance));
+}
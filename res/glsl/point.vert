@@ -0,0 +1,30 @@
+#version 460
+
+layout (binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout (push_constant) uniform Push {
+    mat4 viewProj;
+    vec2 viewportSize;
+    float maxPointSize;
+} push;
+
+layout (location = 3) in vec3 inTransform;
+layout (location = 4) in float inScale;
+
+layout (location = 0) out vec3 fragColor;
+
+void main() {
+    mat4 transform = push.viewProj * ubo.model;
+    gl_Position = transform * vec4(inTransform, 1.0);
+
+    // The body's diameter in pixels, clamped to what the device can rasterise
+    float diameter = inScale * length(transform[0].xy) * 0.5 * push.viewportSize.x;
+    gl_PointSize = clamp(diameter, 1.0, push.maxPointSize);
+
+    // Same colour as the quad's vertices in MeshObject
+    fragColor = vec3(0.4, 0.0, 1.0);
+}
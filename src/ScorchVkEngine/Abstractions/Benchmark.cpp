@@ -0,0 +1,349 @@
+#define FMT_HEADER_ONLY
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <Abstractions/Rendering/Objects/PhysicsHeader.h>
+#include <Abstractions/Sorting.h>
+#include <ScorchV.h>
+
+namespace
+{
+    double millisecondsSince(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct Scene
+    {
+        std::vector<RigidBody> bodies;
+        std::vector<RigidBody*> pointers;
+
+        // A block of resting bodies a little apart from each other, which collapses into a pile under gravity
+        explicit Scene(const uint32_t count, const uint32_t columns = 100)
+        {
+            bodies.reserve(count);
+            pointers.reserve(count);
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const glm::vec2 pos = { -0.5f * columns + static_cast<float>(i % columns), -Physics::boundsY + rad + static_cast<float>(i / columns) * 1.05f };
+                bodies.emplace_back(pos, pos);
+                pointers.emplace_back(&bodies.back());
+            }
+        }
+    };
+
+    // Small bodies scattered over the whole world, with a fraction of them swapped for large ones
+    Scene scatteredScene(const uint32_t count, const float smallRadius, const float largeRadius, const float largeFraction, const glm::vec2 extent)
+    {
+        Scene scene{0};
+        scene.bodies.reserve(count);
+
+        std::mt19937 rng{count};
+        std::uniform_real_distribution<float> x{-0.5f * extent.x, 0.5f * extent.x}, y{-0.5f * extent.y, 0.5f * extent.y}, chance{0.0f, 1.0f};
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const glm::vec2 pos = { x(rng), y(rng) };
+            scene.bodies.emplace_back(pos, pos, i, chance(rng) < largeFraction ? largeRadius : smallRadius);
+            scene.pointers.emplace_back(&scene.bodies.back());
+        }
+
+        return scene;
+    }
+
+    // Bodies of the default size in square clusters, spread at random over a world of worldSize x worldSize
+    Scene clusteredScene(const uint32_t count, const uint32_t clusters, const float worldSize)
+    {
+        Scene scene{0};
+        scene.bodies.reserve(count);
+
+        std::mt19937 rng{count};
+        std::uniform_real_distribution<float> centre{-0.5f * worldSize, 0.5f * worldSize};
+
+        const uint32_t perCluster = count / clusters;
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(perCluster))));
+
+        for (uint32_t c = 0; c < clusters; c++)
+        {
+            const glm::vec2 clusterCentre = { centre(rng), centre(rng) };
+
+            for (uint32_t i = 0; i < perCluster; i++)
+            {
+                const glm::vec2 pos = clusterCentre + 1.05f * glm::vec2(i % side, i / side);
+                scene.bodies.emplace_back(pos, pos, c * perCluster + i);
+                scene.pointers.emplace_back(&scene.bodies.back());
+            }
+        }
+
+        return scene;
+    }
+
+    // Times build + findPairs over a few frames in which every body moves a little, like it would during a substep
+    void benchmarkBroadphase(const std::string& scene, const char* name, Physics::Broadphase& broadphase, Scene& bodies)
+    {
+        constexpr uint32_t frames = 20;
+
+        std::mt19937 rng{frames};
+        std::uniform_real_distribution<float> jitter{-0.02f, 0.02f};
+        std::vector<Physics::BodyPair> pairs;
+
+        // Every broadphase sees the same motion from the same start
+        for (RigidBody& body : bodies.bodies) body.currPos = body.prevPos;
+
+        double time = 0.0;
+
+        for (uint32_t f = 0; f < frames; f++)
+        {
+            for (RigidBody& body : bodies.bodies) body.currPos += glm::vec2(jitter(rng), jitter(rng));
+
+            const auto start = std::chrono::steady_clock::now();
+
+            pairs.clear();
+            broadphase.build(bodies.pointers);
+            broadphase.findPairs(pairs);
+
+            time += millisecondsSince(start);
+        }
+
+        uint32_t contacts = 0;
+        for (const auto [a, b] : pairs)
+        {
+            const RigidBody* body1 = bodies.pointers[a];
+            const RigidBody* body2 = bodies.pointers[b];
+            if (glm::length(body1->currPos - body2->currPos) < body1->radius + body2->radius) contacts++;
+        }
+
+        fmt::print("{:>10} {:>14} {:>14.3f} {:>12} {:>12}\n", scene, name, time / frames, pairs.size(), contacts);
+    }
+
+    struct Penetration
+    {
+        float mean, max;
+    };
+
+    Penetration measurePenetration(const Scene& scene, Physics::Grid& grid)
+    {
+        grid.build(scene.pointers);
+
+        Penetration result{};
+        uint32_t contacts = 0;
+
+        grid.forEachPair([&](const uint32_t a, const uint32_t b)
+        {
+            const RigidBody* body1 = scene.pointers[a];
+            const RigidBody* body2 = scene.pointers[b];
+
+            const float overlap = body1->radius + body2->radius - glm::length(body1->currPos - body2->currPos);
+            if (overlap <= 0.0f) return;
+
+            result.mean += overlap;
+            result.max = std::max(result.max, overlap);
+            contacts++;
+        });
+
+        if (contacts) result.mean /= static_cast<float>(contacts);
+
+        return result;
+    }
+}
+
+bool Benchmark::run(const std::string& name)
+{
+    if (name == "solvers") solvers();
+    else if (name == "broadphases") broadphases();
+    else if (name == "ordering") ordering();
+    else if (name == "sorting") sorting();
+    else if (name == "renderers") renderers();
+    else return false;
+
+    return true;
+}
+
+void Benchmark::solvers()
+{
+    constexpr uint32_t bodyCounts[] = { 2000, 5000 };
+    constexpr uint32_t frames = 120;
+    constexpr float deltaTime = 1.0f / 60.0f;
+
+    constexpr const char* modeNames[] = { "Serial", "Coloured", "Jacobi" };
+
+    fmt::print("{:>8} {:>10} {:>12} {:>14} {:>14}\n", "Bodies", "Solver", "ms/frame", "Mean overlap", "Max overlap");
+
+    for (const uint32_t bodyCount : bodyCounts)
+    {
+        for (int mode = 0; mode < 3; mode++)
+        {
+            Scene scene{bodyCount};
+            Physics::Grid grid{128, 72, 1};
+            Physics::ContactSolver solver;
+            solver.mode = static_cast<Physics::SolverMode>(mode);
+
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t f = 0; f < frames; f++) Physics::Update(scene.pointers, grid, solver, deltaTime);
+            const double frameTime = millisecondsSince(start) / frames;
+
+            // Residual overlap once the pile has settled is what tells the solvers' convergence apart
+            const Penetration penetration = measurePenetration(scene, grid);
+
+            fmt::print("{:>8} {:>10} {:>12.3f} {:>14.5f} {:>14.5f}\n", bodyCount, modeNames[mode], frameTime, penetration.mean, penetration.max);
+        }
+    }
+}
+
+void Benchmark::broadphases()
+{
+    constexpr uint32_t bodyCount = 100000;
+    constexpr glm::vec2 extent = { 2 * Physics::boundsX, 2 * Physics::boundsY };
+
+    fmt::print("{:>10} {:>14} {:>14} {:>12} {:>12}\n", "Scene", "Broadphase", "Build+Pairs ms", "Candidates", "Contacts");
+
+    // Dense and inside the bounds, with a 10x size ratio the grid has to size every cell for the few large bodies
+    {
+        Physics::Grid grid{128, 72, 1};
+        Physics::IncrementalGrid incrementalGrid{128, 72, 1};
+        Physics::HierarchicalGrid hierarchicalGrid{extent};
+        Physics::AABBTree aabbTree;
+        Physics::SortAndSweep sortAndSweep;
+
+        for (const float largeFraction : { 0.0f, 0.01f, 0.05f })
+        {
+            Scene scene = scatteredScene(bodyCount, 0.1f, 1.0f, largeFraction, extent);
+            const std::string label = fmt::format("Large {:.0f}%", 100 * largeFraction);
+
+            benchmarkBroadphase(label, "Grid", grid, scene);
+            benchmarkBroadphase(label, "Incremental", incrementalGrid, scene);
+            benchmarkBroadphase(label, "Hierarchical", hierarchicalGrid, scene);
+            benchmarkBroadphase(label, "AABB Tree", aabbTree, scene);
+            benchmarkBroadphase(label, "Sort and Sweep", sortAndSweep, scene);
+        }
+    }
+
+    // Sparse clusters over worlds far larger than the bounds. The bounded grid would pile every outlier into its border
+    // cells and pair them all up, so only a grid stretched over the whole world is compared, while it still fits in
+    // memory. Past that, the hierarchical grid has to coarsen its cells to stay within its cell budget.
+    {
+        Physics::Grid worldGrid{4096, 4096, 1};
+        Physics::AABBTree aabbTree;
+        Physics::SortAndSweep sortAndSweep;
+
+        for (const float worldSize : { 4096.0f, 65536.0f })
+        {
+            Physics::HierarchicalGrid hierarchicalGrid{glm::vec2{worldSize}};
+
+            Scene scene = clusteredScene(bodyCount, 64, worldSize);
+            const std::string label = fmt::format("Sparse {}", worldSize);
+
+            if (worldSize <= worldGrid.extent.x) benchmarkBroadphase(label, "World Grid", worldGrid, scene);
+            benchmarkBroadphase(label, "Hierarchical", hierarchicalGrid, scene);
+            benchmarkBroadphase(label, "AABB Tree", aabbTree, scene);
+            benchmarkBroadphase(label, "Sort and Sweep", sortAndSweep, scene);
+        }
+    }
+}
+
+void Benchmark::ordering()
+{
+    constexpr uint32_t bodyCount = 100000;
+    constexpr uint32_t frames = 60;
+    constexpr float deltaTime = 1.0f / 60.0f;
+    constexpr glm::vec2 extent = { 2 * Physics::boundsX, 2 * Physics::boundsY };
+
+    fmt::print("{:>14} {:>12} {:>12}\n", "Memory order", "ms/frame", "Reorder ms");
+
+    for (const bool reorder : { false, true })
+    {
+        // Scattered in random order, so memory order starts out unrelated to position
+        Scene scene = scatteredScene(bodyCount, 0.1f, 0.1f, 0.0f, extent);
+        Physics::Grid grid{128, 72, 1};
+        Physics::ContactSolver solver;
+        Physics::MortonOrder order{extent};
+
+        double reorderTime = 0.0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t f = 0; f < frames; f++)
+        {
+            if (reorder && f % Physics::MortonOrder::reorderInterval == 0)
+            {
+                const auto reorderStart = std::chrono::steady_clock::now();
+                order.reorder(scene.pointers);
+                reorderTime += millisecondsSince(reorderStart);
+            }
+
+            Physics::Update(scene.pointers, grid, solver, deltaTime);
+        }
+
+        const double frameTime = millisecondsSince(start) / frames;
+        const uint32_t reorders = (frames + Physics::MortonOrder::reorderInterval - 1) / Physics::MortonOrder::reorderInterval;
+
+        fmt::print("{:>14} {:>12.3f} {:>12.3f}\n", reorder ? "Z-order" : "Spawn", frameTime, reorder ? reorderTime / reorders : 0.0);
+    }
+}
+
+void Benchmark::sorting()
+{
+    constexpr uint32_t counts[] = { 100000, 1000000, 4000000 };
+    constexpr uint32_t repeats = 10;
+
+    fmt::print("{:>10} {:>14} {:>14} {:>14} {:>8}\n", "Keys", "std::sort ms", "par sort ms", "Radix ms", "Match");
+
+    for (const uint32_t count : counts)
+    {
+        std::mt19937 rng{count};
+
+        std::vector<uint32_t> sourceKeys(count);
+        for (uint32_t& key : sourceKeys) key = rng();
+
+        // The comparison sorts carry the value in the low half of the key, which also makes them stable
+        std::vector<uint64_t> packed(count);
+        double serialTime = 0.0, parallelTime = 0.0, radixTime = 0.0;
+
+        for (uint32_t r = 0; r < repeats; r++)
+        {
+            for (uint32_t i = 0; i < count; i++) packed[i] = static_cast<uint64_t>(sourceKeys[i]) << 32 | i;
+            auto start = std::chrono::steady_clock::now();
+            std::sort(packed.begin(), packed.end());
+            serialTime += millisecondsSince(start);
+
+            for (uint32_t i = 0; i < count; i++) packed[i] = static_cast<uint64_t>(sourceKeys[i]) << 32 | i;
+            start = std::chrono::steady_clock::now();
+            std::sort(std::execution::par, packed.begin(), packed.end());
+            parallelTime += millisecondsSince(start);
+        }
+
+        Sorting::RadixSorter sorter;
+        std::vector<uint32_t> keys, values(count);
+
+        for (uint32_t r = 0; r < repeats; r++)
+        {
+            keys = sourceKeys;
+            std::iota(values.begin(), values.end(), 0);
+
+            const auto start = std::chrono::steady_clock::now();
+            sorter.sort(keys, values);
+            radixTime += millisecondsSince(start);
+        }
+
+        bool match = true;
+        for (uint32_t i = 0; i < count && match; i++)
+            match = keys[i] == static_cast<uint32_t>(packed[i] >> 32) && values[i] == static_cast<uint32_t>(packed[i]);
+
+        fmt::print("{:>10} {:>14.3f} {:>14.3f} {:>14.3f} {:>8}\n", count, serialTime / repeats, parallelTime / repeats, radixTime / repeats, match ? "yes" : "NO");
+    }
+}
+
+void Benchmark::renderers()
+{
+    ScorchV app;
+    app.benchmarkRenderers();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// Benchmarks, started with `ScorchV --bench <name>`. All but renderers run headless, instead of opening a window.
+namespace Benchmark
+{
+    bool run(const std::string& name);
+
+    void solvers();
+    void broadphases();
+    void ordering();
+    void sorting();
+    void renderers();
+}
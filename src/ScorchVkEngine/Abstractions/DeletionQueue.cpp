@@ -0,0 +1,14 @@
+#include "DeletionQueue.h"
+
+DeletionQueue* DeletionQueue::instance = nullptr;
+
+void DeletionQueue::flush(const uint64_t completedFrame)
+{
+    while (!entries.empty() && entries.front().frame <= completedFrame)
+    {
+        // Taken off first, so a destroy that pushes more cannot invalidate it
+        const std::function<void()> destroy = std::move(entries.front().destroy);
+        entries.pop_front();
+        destroy();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+// Destroys Vulkan objects once the GPU is done with them, instead of idling the device first. Everything pushed is
+// tagged with the number of frames submitted so far, any of which may still use it, and is destroyed once the fence of
+// the last of them has signalled. Render thread only.
+class DeletionQueue
+{
+public:
+    static DeletionQueue* instance;
+    static DeletionQueue* getInstance()
+    {
+        if (!instance) instance = new DeletionQueue();
+        return instance;
+    }
+
+    // Called once per queue submission of a frame, returns the frame's number
+    uint64_t frameSubmitted() { return ++submittedFrames; }
+    uint64_t getSubmittedFrames() const { return submittedFrames; }
+
+    void push(std::function<void()> destroy) { entries.push_back({ submittedFrames, std::move(destroy) }); }
+
+    // Destroys whatever no frame after completedFrame can have used. A frame's fence covers every submission before it,
+    // so the one that signalled vouches for all earlier frames too.
+    void flush(uint64_t completedFrame);
+
+    // Only once the device is idle
+    void flushAll() { flush(UINT64_MAX); }
+
+private:
+    struct Entry
+    {
+        uint64_t frame;
+        std::function<void()> destroy;
+    };
+
+    DeletionQueue() {}
+
+    std::deque<Entry> entries;
+    uint64_t submittedFrames = 0;
+};
@@ -0,0 +1,176 @@
+#define FMT_HEADER_ONLY
+#include "FrameWriter.h"
+
+#include <algorithm>
+#include <array>
+
+#include <fmt/core.h>
+
+namespace
+{
+    std::array<uint32_t, 256> makeCrcTable()
+    {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }
+
+    uint32_t crc32(const uint8_t* data, const size_t size, uint32_t crc = 0)
+    {
+        static const std::array<uint32_t, 256> table = makeCrcTable();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void putBigEndian(std::vector<uint8_t>& out, const uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    void writeChunk(std::FILE* file, const char type[4], const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(data.size() + 12);
+
+        putBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        putBigEndian(chunk, crc32(chunk.data() + 4, data.size() + 4));
+
+        std::fwrite(chunk.data(), 1, chunk.size(), file);
+    }
+}
+
+FrameWriter::FrameWriter() : writer(&FrameWriter::writeFrames, this) {}
+
+std::vector<uint8_t> FrameWriter::takeBuffer(const size_t size)
+{
+    std::vector<uint8_t> buffer;
+
+    {
+        std::lock_guard lock(mutex);
+        if (!spare.empty())
+        {
+            buffer = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    buffer.resize(size);
+    return buffer;
+}
+
+void FrameWriter::write(std::string path, const uint32_t width, const uint32_t height, const FrameFormat format, std::vector<uint8_t> pixels)
+{
+    std::unique_lock lock(mutex);
+    queueChanged.wait(lock, [this] { return queue.size() < maxQueued; });
+
+    queue.push_back({ std::move(path), width, height, format, std::move(pixels) });
+    queueChanged.notify_all();
+}
+
+void FrameWriter::finish()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+
+    if (writer.joinable()) writer.join();
+}
+
+void FrameWriter::writeFrames()
+{
+    std::unique_lock lock(mutex);
+
+    while (true)
+    {
+        queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+
+        Frame frame = std::move(queue.front());
+        queue.pop_front();
+        queueChanged.notify_all();
+
+        lock.unlock();
+
+        if (std::FILE* file = std::fopen(frame.path.c_str(), "wb"))
+        {
+            if (frame.format == FrameFormat::Png) writePng(file, frame.width, frame.height, frame.pixels);
+            else std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), file);
+
+            std::fclose(file);
+        }
+        else fmt::print(fmterr, "Failed to open {} for the frame!\n", frame.path);
+
+        lock.lock();
+        spare.push_back(std::move(frame.pixels));
+    }
+}
+
+// No compression: the image goes into stored deflate blocks, which keeps the writer to a few lines and as fast as the
+// disk. The files are about as large as the raw ones.
+void FrameWriter::writePng(std::FILE* file, const uint32_t width, const uint32_t height, const std::vector<uint8_t>& pixels)
+{
+    constexpr uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::fwrite(signature, 1, sizeof(signature), file);
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 }); // Eight bits per channel of RGB, no interlacing
+    writeChunk(file, "IHDR", header);
+
+    // Every scanline starts with its filter type, none
+    const size_t rowSize = 1 + static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> scanlines(rowSize * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint8_t* row = scanlines.data() + y * rowSize;
+        const uint8_t* source = pixels.data() + static_cast<size_t>(y) * width * 4;
+
+        row[0] = 0;
+        for (uint32_t x = 0; x < width; x++) std::copy_n(source + x * 4, 3, row + 1 + x * 3);
+    }
+
+    constexpr size_t maxBlock = 65535;
+    std::vector<uint8_t> zlib;
+    zlib.reserve(scanlines.size() + scanlines.size() / maxBlock * 5 + 16);
+    zlib.insert(zlib.end(), { 0x78, 0x01 });
+
+    for (size_t offset = 0; offset < scanlines.size(); offset += maxBlock)
+    {
+        const size_t size = std::min(maxBlock, scanlines.size() - offset);
+        const bool last = offset + size == scanlines.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.insert(zlib.end(), { static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8) });
+        zlib.insert(zlib.end(), scanlines.begin() + static_cast<std::ptrdiff_t>(offset), scanlines.begin() + static_cast<std::ptrdiff_t>(offset + size));
+    }
+
+    // Adler-32, reduced every 5552 bytes, the most that cannot overflow
+    uint32_t a = 1, b = 0;
+    for (size_t offset = 0; offset < scanlines.size(); offset += 5552)
+    {
+        const size_t end = std::min(offset + 5552, scanlines.size());
+        for (size_t i = offset; i < end; i++)
+        {
+            a += scanlines[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    putBigEndian(zlib, b << 16 | a);
+
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class FrameFormat
+{
+    Png, // RGB, alpha dropped
+    Raw  // The RGBA bytes as read back, for piping into an encoder
+};
+
+// Writes rendered frames to disk on a thread of its own. Frames queue up while the disk is busy, up to maxQueued, after
+// which write blocks, so a slow disk slows the run down rather than filling memory with frames.
+class FrameWriter
+{
+public:
+    static constexpr size_t maxQueued = 4;
+
+    FrameWriter();
+    ~FrameWriter() { finish(); }
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Pixel storage to fill and hand to write, recycled from frames already written
+    std::vector<uint8_t> takeBuffer(size_t size);
+
+    // Queues a tightly packed RGBA8 frame to be written to path
+    void write(std::string path, uint32_t width, uint32_t height, FrameFormat format, std::vector<uint8_t> pixels);
+
+    // Waits for every queued frame to be written and stops the thread
+    void finish();
+
+private:
+    struct Frame
+    {
+        std::string path;
+        uint32_t width, height;
+        FrameFormat format;
+        std::vector<uint8_t> pixels;
+    };
+
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<Frame> queue;
+    std::vector<std::vector<uint8_t>> spare;
+    bool stopping = false;
+
+    // Declared last so everything the thread touches exists before it starts
+    std::thread writer;
+
+    void writeFrames();
+
+    static void writePng(std::FILE* file, uint32_t width, uint32_t height, const std::vector<uint8_t>& pixels);
+};
@@ -2,10 +2,12 @@
 
 #include <iterator>
 #include <stdexcept>
+#include <functional>
+#include <algorithm>
 
 GuiManager* GuiManager::instance = nullptr;
 
-void GuiManager::setupImGui(VkInstance instance, GLFWwindow* window, VkQueue graphicsQueue, VkRenderPass renderPass)
+void GuiManager::setupImGui(VkInstance instance, GLFWwindow* window, VkQueue graphicsQueue)
 {
     const VkDescriptorPoolSize pool_sizes[] =
     {
@@ -46,10 +48,16 @@ void GuiManager::setupImGui(VkInstance instance, GLFWwindow* window, VkQueue gra
     initInfo.Device = presentMan->device;
     initInfo.Queue = graphicsQueue;
     initInfo.DescriptorPool = imguiPool;
-    initInfo.MinImageCount = 3;
-    initInfo.ImageCount = 3;
+    // ImGui keeps a vertex and index buffer per image, and moves on to the next one every frame. There must be at least
+    // as many as there are frames in flight, or it rewrites one the GPU is still reading.
+    initInfo.MinImageCount = presentMan->minImageCount;
+    initInfo.ImageCount = std::max({ presentMan->imageCount, presentMan->framesInFlight, presentMan->minImageCount });
 
-    ImGui_ImplVulkan_Init(&initInfo, renderPass);
+    // Drawn inside the frame's dynamic rendering, so the pipeline is built for the attachment format, not a render pass
+    initInfo.UseDynamicRendering = true;
+    initInfo.ColorAttachmentFormat = presentMan->swapChainImageFormat;
+
+    ImGui_ImplVulkan_Init(&initInfo, VK_NULL_HANDLE);
 
     io.Fonts->AddFontFromFileTTF("..\\res\\fonts\\SpaceMono-Regular.ttf", 20.0f);
 
@@ -169,3 +177,106 @@ void GuiManager::renderGui()
 {
     ImGui::Render();
 }
+
+#ifdef SCORCH_PROFILING
+namespace
+{
+    // One flame graph row, covering length nanoseconds from origin. Scopes that stick out of it are clipped to it.
+    void drawFlameRow(const char* label, const std::vector<ProfileEvent>& events, const uint32_t depthCount, const uint64_t origin, const double length)
+    {
+        constexpr float rowHeight = 20.0f;
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+
+        ImGui::TextUnformatted(label);
+
+        const ImVec2 corner = ImGui::GetCursorScreenPos();
+        ImGui::PushID(label);
+        ImGui::InvisibleButton("Flame", { width, rowHeight * static_cast<float>(std::max(depthCount, 1u)) });
+        ImGui::PopID();
+
+        for (const ProfileEvent& event : events)
+        {
+            const double start = std::clamp(static_cast<double>(event.start) - static_cast<double>(origin), 0.0, length) / length;
+            const double end = std::clamp(static_cast<double>(event.end) - static_cast<double>(origin), 0.0, length) / length;
+
+            const ImVec2 min = { corner.x + static_cast<float>(start) * width, corner.y + rowHeight * static_cast<float>(event.depth) };
+            const ImVec2 max = { std::max(corner.x + static_cast<float>(end) * width, min.x + 1.0f), min.y + rowHeight - 1.0f };
+
+            // Same scope, same colour, from frame to frame
+            const size_t hash = std::hash<std::string_view>{}(event.name);
+            const ImU32 colour = IM_COL32(160 + hash % 96, 60 + (hash >> 8) % 120, (hash >> 16) % 40, 255);
+            drawList->AddRectFilled(min, max, colour, 2.0f);
+
+            drawList->PushClipRect(min, max, true);
+            drawList->AddText({ min.x + 2.0f, min.y }, IM_COL32_WHITE, event.name);
+            drawList->PopClipRect();
+
+            if (ImGui::IsMouseHoveringRect(min, max))
+                ImGui::SetTooltip("%s: %.3f ms", event.name, static_cast<double>(event.end - event.start) * 1e-6);
+        }
+    }
+}
+#endif
+
+void GuiManager::drawProfiler()
+{
+    if (!ImGui::Begin("Profiler"))
+    {
+        ImGui::End();
+        return;
+    }
+
+#ifdef SCORCH_PROFILING
+    Profiler* profiler = Profiler::getInstance();
+    const Profiler::Frame& frame = profiler->getFrame();
+    const double frameLength = static_cast<double>(std::max<uint64_t>(frame.end - frame.start, 1));
+
+    // A GPU that is busy for about the whole frame interval is what the frame waits on, otherwise it is the CPU
+    uint64_t gpuStart = UINT64_MAX, gpuEnd = 0;
+    for (const ProfileEvent& event : frame.gpu)
+    {
+        gpuStart = std::min(gpuStart, event.start);
+        gpuEnd = std::max(gpuEnd, event.end);
+    }
+    const uint64_t gpuLength = frame.gpu.empty() ? 0 : gpuEnd - gpuStart;
+
+    ImGui::Checkbox("Pause", &profiler->paused);
+    ImGui::SameLine();
+    ImGui::Text("CPU frame: %.3f ms  GPU: %.3f ms", frameLength * 1e-6, static_cast<double>(gpuLength) * 1e-6);
+
+    if (profiler->isCapturing()) ImGui::TextUnformatted("Capturing a trace...");
+    else if (ImGui::Button("Capture Trace (F9)")) profiler->startCapture(Profiler::defaultCaptureFrames, "trace.json");
+
+    for (const Profiler::ThreadFrame& thread : frame.threads)
+        drawFlameRow(thread.name, thread.events, thread.depthCount, frame.start, frameLength);
+
+    if (!frame.gpu.empty()) drawFlameRow("GPU", frame.gpu, 1, gpuStart, frameLength);
+
+    if (ImGui::BeginTable("Scopes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Min ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("P99 ms");
+        ImGui::TableHeadersRow();
+
+        for (const auto& [name, stats] : profiler->getStats())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(name.data(), name.data() + name.size());
+            ImGui::TableNextColumn(); ImGui::Text("%u", stats.calls);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.min);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.avg);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.p99);
+        }
+
+        ImGui::EndTable();
+    }
+#else
+    ImGui::TextUnformatted("Profiling is compiled out of this build, define SCORCH_PROFILING to keep it.");
+#endif
+
+    ImGui::End();
+}
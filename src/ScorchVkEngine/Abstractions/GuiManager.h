@@ -6,6 +6,7 @@
 #include <imgui/backends/imgui_impl_glfw.h>
 #include <Abstractions/Rendering/BufferManager.h>
 #include <Abstractions/PresentationManager.h>
+#include <Abstractions/Profiler.h>
 
 class GuiManager
 {
@@ -19,12 +20,15 @@ public:
 
     VkImage fontImage{};
 
-    void setupImGui(VkInstance instance, GLFWwindow* window, VkQueue graphicsQueue, VkRenderPass renderPass);
+    void setupImGui(VkInstance instance, GLFWwindow* window, VkQueue graphicsQueue);
     void destroyImGui();
 
     static void newFrame();
     static void renderGui();
 
+    // Flame graph of the last frame on every thread, and timings per scope
+    static void drawProfiler();
+
 private:
     GuiManager() {}
 
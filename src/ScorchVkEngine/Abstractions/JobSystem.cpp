@@ -0,0 +1,142 @@
+#include "JobSystem.h"
+
+#include <cstdio>
+
+#include <Abstractions/Profiler.h>
+
+JobSystem* JobSystem::instance = nullptr;
+
+namespace
+{
+    // Index of the calling thread's queue, zero for threads that are not workers
+    thread_local uint32_t queueIndex = 0;
+
+    constexpr uint32_t idleSpins = 64; // Attempts to find work before a worker goes to sleep
+}
+
+JobSystem::JobSystem()
+{
+    const uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    queues.reserve(workerCount + 1);
+    for (uint32_t i = 0; i <= workerCount; i++) queues.emplace_back(std::make_unique<Queue>());
+
+    workers.reserve(workerCount);
+    for (uint32_t i = 1; i <= workerCount; i++) workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+void JobSystem::shutdown()
+{
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+}
+
+void JobSystem::push(const Job& job)
+{
+    Queue& queue = *queues[queueIndex];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+    queuedCount.fetch_add(1, std::memory_order_release);
+}
+
+bool JobSystem::pop(Job& job)
+{
+    // Newest job of our own first, it is the most likely to still be in cache
+    {
+        Queue& queue = *queues[queueIndex];
+        std::lock_guard lock(queue.mutex);
+
+        if (!queue.jobs.empty())
+        {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+            queuedCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Then the oldest job of someone else
+    const uint32_t queueCount = static_cast<uint32_t>(queues.size());
+    for (uint32_t offset = 1; offset < queueCount; offset++)
+    {
+        Queue& queue = *queues[(queueIndex + offset) % queueCount];
+        std::lock_guard lock(queue.mutex);
+
+        if (!queue.jobs.empty())
+        {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+            queuedCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::wakeWorkers(const uint32_t count)
+{
+    // Taking the lock orders this against a worker that has just checked for work and is about to sleep
+    { std::lock_guard lock(sleepMutex); }
+
+    if (count >= workers.size()) wake.notify_all();
+    else for (uint32_t i = 0; i < count; i++) wake.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    Job job{};
+
+    while (counter.pending.load(std::memory_order_acquire) > 0)
+    {
+        if (pop(job))
+        {
+            job.function(job.data, job.first, job.last);
+            job.counter->pending.fetch_sub(1, std::memory_order_release);
+        }
+        else std::this_thread::yield();
+    }
+}
+
+void JobSystem::workerLoop(const uint32_t index)
+{
+    queueIndex = index;
+
+#ifdef SCORCH_PROFILING
+    char name[Profiler::threadNameLength];
+    snprintf(name, sizeof(name), "Worker %u", index);
+    SCORCH_PROFILE_THREAD(name);
+#endif
+
+    Job job{};
+    uint32_t spins = 0;
+
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        if (pop(job))
+        {
+            job.function(job.data, job.first, job.last);
+            job.counter->pending.fetch_sub(1, std::memory_order_release);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < idleSpins)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping.load(std::memory_order_relaxed) || queuedCount.load(std::memory_order_acquire) > 0; });
+        spins = 0;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
+
+// Counts the jobs of a batch that have not finished yet
+struct JobCounter
+{
+    std::atomic<uint32_t> pending{0};
+};
+
+// Work-stealing job scheduler. Every worker has its own deque: it takes jobs from the back of its own, and once that is
+// empty it steals from the front of the others. Threads that are not workers queue into a shared deque, and help run
+// jobs while they wait on a counter instead of blocking.
+class JobSystem
+{
+public:
+    static JobSystem* instance;
+    static JobSystem* getInstance()
+    {
+        if (!instance) instance = new JobSystem();
+        return instance;
+    }
+
+    // Workers plus the thread that waits
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+    // Queues f(), which has to stay alive until counter has been waited on
+    template<typename F>
+    void run(F& f, JobCounter& counter)
+    {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        push({ [](void* data, uint32_t, uint32_t) { (*static_cast<F*>(data))(); }, &f, 0, 0, &counter });
+        wakeWorkers(1);
+    }
+
+    // Calls f(first, last) over ranges of about grain items covering [0, count), and returns once they are all done
+    template<typename F>
+    void parallelFor(const uint32_t count, const uint32_t grain, F&& f)
+    {
+        const uint32_t jobCount = (count + grain - 1) / grain;
+
+        if (jobCount <= 1 || workers.empty())
+        {
+            if (count) f(0u, count);
+            return;
+        }
+
+        JobCounter counter;
+        counter.pending.store(jobCount, std::memory_order_relaxed);
+
+        for (uint32_t job = 0; job < jobCount; job++)
+        {
+            push({ [](void* data, const uint32_t first, const uint32_t last) { (*static_cast<std::remove_reference_t<F>*>(data))(first, last); },
+                   &f, job * grain, std::min((job + 1) * grain, count), &counter });
+        }
+
+        wakeWorkers(jobCount);
+        wait(counter);
+    }
+
+    // Runs queued jobs until every job of counter has finished
+    void wait(JobCounter& counter);
+
+    void shutdown();
+
+private:
+    struct Job
+    {
+        void (*function)(void* data, uint32_t first, uint32_t last);
+        void* data;
+        uint32_t first, last;
+        JobCounter* counter;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    JobSystem();
+
+    std::vector<std::unique_ptr<Queue>> queues; // The shared one first, then one per worker
+    std::vector<std::thread> workers;
+
+    std::atomic<uint32_t> queuedCount{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    void push(const Job& job);
+    bool pop(Job& job);
+    void wakeWorkers(uint32_t count);
+
+    void workerLoop(uint32_t queueIndex);
+};
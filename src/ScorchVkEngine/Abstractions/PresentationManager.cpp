@@ -1,5 +1,7 @@
 #include "PresentationManager.h"
 
+#include <Abstractions/DeletionQueue.h>
+
 #include <algorithm>
 #include <set>
 #include <string>
@@ -23,10 +25,22 @@ void PresentationManager::setUpPresentation(VkInstance instance, GLFWwindow* win
     createImageViews();
 }
 
+void PresentationManager::setUpHeadless(VkInstance instance, ValidationLayers& vLayers, VkQueue& gfxQ, const VkExtent2D extent, const VkFormat format)
+{
+    // Any device with a graphics queue will do, software ones like lavapipe included
+    pickPhysicalDevice(instance);
+
+    VkQueue prstQ;
+    createLogicalDevice(vLayers, gfxQ, prstQ);
+
+    swapChainImageFormat = format;
+    swapChainExtent = extent;
+}
+
 void PresentationManager::destroyPresentation(VkInstance instance)
 {
     vkDestroyDevice(device, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (surface) vkDestroySurfaceKHR(instance, surface, nullptr);
 }
 
 void PresentationManager::framebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -38,6 +52,10 @@ void PresentationManager::framebufferResizeCallback(GLFWwindow* window, int widt
 bool PresentationManager::isDeviceSuitable(VkPhysicalDevice& device)
 {
     _indices = findQueueFamilies(device);
+    if (!supportsRequiredFeatures(device)) return false;
+
+    // Headless, nothing is presented
+    if (!surface) return _indices.isComplete();
 
     const bool extensionsSupported = checkDeviceExtensionSupport(device);
     bool swapChainAdequate = false;
@@ -64,8 +82,9 @@ QueueFamilyIndices PresentationManager::findQueueFamilies(VkPhysicalDevice& devi
     for (const auto& queueFamily : queueFamilies) {
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) indices.graphicsFamily = i;
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        // Without a surface the graphics queue stands in for the present one
+        VkBool32 presentSupport = !surface && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+        if (surface) vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
         if (presentSupport) indices.presentFamily = i;
 
         if (indices.isComplete()) break;
@@ -104,6 +123,11 @@ SwapChainSupportDetails PresentationManager::querySwapChainSupport(VkPhysicalDev
 }
 
 bool PresentationManager::checkDeviceExtensionSupport(VkPhysicalDevice& device)
+{
+    return checkDeviceExtensionSupport(device, deviceExtensions);
+}
+
+bool PresentationManager::checkDeviceExtensionSupport(VkPhysicalDevice& device, const std::vector<const char*>& extensions)
 {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -111,7 +135,7 @@ bool PresentationManager::checkDeviceExtensionSupport(VkPhysicalDevice& device)
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions)
     {
@@ -121,6 +145,25 @@ bool PresentationManager::checkDeviceExtensionSupport(VkPhysicalDevice& device)
     return requiredExtensions.empty();
 }
 
+bool PresentationManager::supportsRequiredFeatures(VkPhysicalDevice& device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    // The Vulkan 1.3 features structure is only valid on a 1.3 device
+    if (properties.apiVersion < VK_API_VERSION_1_3) return false;
+
+    VkPhysicalDeviceVulkan13Features features13{};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features13;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return features13.dynamicRendering && features13.synchronization2;
+}
+
 void PresentationManager::pickPhysicalDevice(VkInstance instance)
 {
     uint32_t deviceCount = 0;
@@ -160,15 +203,111 @@ void PresentationManager::createLogicalDevice(ValidationLayers vLayers, VkQueue&
 
     VkPhysicalDeviceFeatures deviceFeatures{};
 
+    VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+    supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    // Only chained when the extensions are there, the structures are not valid otherwise
+    const bool presentWaitExtensionsSupported = surface && checkDeviceExtensionSupport(physicalDevice, presentWaitExtensions);
+
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait{};
+    supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId{};
+    supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    supportedPresentId.pNext = &supportedPresentWait;
+
+    const bool swapchainMaintenanceSupported = surface && vLayers.surfaceMaintenance && checkDeviceExtensionSupport(physicalDevice, swapchainMaintenanceExtensions);
+
+    VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT supportedMaintenance{};
+    supportedMaintenance.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+
+    void** supportedNext = &supportedFeatures12.pNext;
+    if (presentWaitExtensionsSupported)
+    {
+        *supportedNext = &supportedPresentId;
+        supportedNext = &supportedPresentWait.pNext;
+    }
+    if (swapchainMaintenanceSupported) *supportedNext = &supportedMaintenance;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supportedFeatures12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.drawIndirectCount = supportedFeatures12.drawIndirectCount;
+    drawIndirectCount = features12.drawIndirectCount == VK_TRUE;
+
+    // Required, isDeviceSuitable checked for them
+    VkPhysicalDeviceVulkan13Features features13{};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.dynamicRendering = VK_TRUE;
+    features13.synchronization2 = VK_TRUE;
+    features12.pNext = &features13;
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = VK_TRUE;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+
+    VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures{};
+    maintenanceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+    maintenanceFeatures.swapchainMaintenance1 = VK_TRUE;
+
+    std::vector<const char*> extensions;
+    if (surface) extensions = deviceExtensions;
+
+    // Core in 1.3, but ImGui looks its entry points up by their KHR names
+    if (checkDeviceExtensionSupport(physicalDevice, dynamicRenderingExtensions))
+        extensions.insert(extensions.end(), dynamicRenderingExtensions.begin(), dynamicRenderingExtensions.end());
+
+    void** next = &features13.pNext;
+    presentWait = presentWaitExtensionsSupported && supportedPresentId.presentId && supportedPresentWait.presentWait;
+    if (presentWait)
+    {
+        *next = &presentIdFeatures;
+        next = &presentWaitFeatures.pNext;
+        extensions.insert(extensions.end(), presentWaitExtensions.begin(), presentWaitExtensions.end());
+    }
+
+    swapchainMaintenance = swapchainMaintenanceSupported && supportedMaintenance.swapchainMaintenance1;
+    if (swapchainMaintenance)
+    {
+        *next = &maintenanceFeatures;
+        extensions.insert(extensions.end(), swapchainMaintenanceExtensions.begin(), swapchainMaintenanceExtensions.end());
+    }
+
+    deviceFeatures.largePoints = supportedFeatures.features.largePoints;
+    largePoints = deviceFeatures.largePoints == VK_TRUE;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    maxPointSize = largePoints ? properties.limits.pointSizeRange[1] : 1.0f;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    timestampValidBits = queueFamilies[_indices.graphicsFamily.value()].timestampValidBits;
+    timestampPeriod = properties.limits.timestampPeriod;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &features12;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (vLayers.enableValidationLayers)
     {
@@ -182,39 +321,54 @@ void PresentationManager::createLogicalDevice(ValidationLayers vLayers, VkQueue&
 
     vkGetDeviceQueue(device, _indices.graphicsFamily.value(), 0, &gfxQ);
     vkGetDeviceQueue(device, _indices.presentFamily.value(), 0, &prstQ);
+
+    if (presentWait) waitForPresentKHR = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+    presentWait = waitForPresentKHR != nullptr;
 }
 
 void PresentationManager::cleanupSwapChain()
 {
-    for (const auto framebuffer : swapChainFramebuffers)  { vkDestroyFramebuffer(device, framebuffer, nullptr); }
+    // The device is idle by now, but presents are not covered by that. Bounded, in case one never signals.
+    for (const PresentFence& present : presentFences) vkWaitForFences(device, 1, &present.fence, VK_TRUE, 100'000'000);
+    for (const PresentFence& present : presentFences) freePresentFences.push_back(present.fence);
+    presentFences.clear();
+
+    for (const VkSwapchainKHR retired : retiredSwapChains) vkDestroySwapchainKHR(device, retired, nullptr);
+    retiredSwapChains.clear();
+    for (const VkFence fence : freePresentFences) vkDestroyFence(device, fence, nullptr);
+    freePresentFences.clear();
+
     for (const auto imageView: swapChainImageViews) { vkDestroyImageView(device, imageView, nullptr); }
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    if (swapChain) vkDestroySwapchainKHR(device, swapChain, nullptr);
 }
 
-void PresentationManager::recreateSwapChain(VkRenderPass renderPass)
+void PresentationManager::recreateSwapChain()
 {
     swapChainSupport = querySwapChainSupport(physicalDevice);
     int width(0), height(0);
     glfwGetFramebufferSize(ptrWindow, &width, &height);
     if (width == 0 || height == 0) return;
 
-    vkDeviceWaitIdle(device);
-
-    for (const auto frameBuffer : swapChainFramebuffers) vkDestroyFramebuffer(device, frameBuffer, nullptr);
-    for (const auto imageView : swapChainImageViews) vkDestroyImageView(device, imageView, nullptr);
+    // Frames in flight may still render into the old views, so they go once those frames are done. Rendering is
+    // dynamic, there are no framebuffers to rebuild.
+    DeletionQueue::getInstance()->push([device = device, imageViews = std::move(swapChainImageViews)]
+    {
+        for (const auto imageView : imageViews) vkDestroyImageView(device, imageView, nullptr);
+    });
+    swapChainImageViews.clear();
 
     createSwapChain();
     createImageViews();
-    createFramebuffers(renderPass);
 }
 
 void PresentationManager::createSwapChain()
 {
     const VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    const VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     const VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    minImageCount = std::max(swapChainSupport.capabilities.minImageCount, 2u);
+    imageCount = std::max(requestedImageCount ? requestedImageCount : swapChainSupport.capabilities.minImageCount + 1, swapChainSupport.capabilities.minImageCount);
 
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
         imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -261,8 +415,10 @@ void PresentationManager::createSwapChain()
     if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
         throw std::runtime_error("Failed to create swapchain!");
 
-    if (createInfo.oldSwapchain != VK_NULL_HANDLE)
-        vkDestroySwapchainKHR(device, createInfo.oldSwapchain, nullptr);
+    if (oldSwapChain != VK_NULL_HANDLE) retireSwapChain(oldSwapChain);
+
+    // Present ids count per swap chain
+    presentId = 0;
 
     vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
     swapChainImages.resize(imageCount);
@@ -302,49 +458,140 @@ void PresentationManager::createImageViews()
     }
 }
 
-void PresentationManager::createFramebuffers(VkRenderPass renderPass)
+VkSurfaceFormatKHR PresentationManager::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 {
-    swapChainFramebuffers.resize(swapChainImageViews.size());
+    for (const auto& availableFormat : availableFormats)
+    {
+        if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+            return availableFormat;
+    }
+
+    return availableFormats[0];
+}
+VkPresentModeKHR PresentationManager::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const
+{
+    const auto available = [&](const VkPresentModeKHR mode)
+    {
+        return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end();
+    };
+
+    if (available(requestedPresentMode)) return requestedPresentMode;
+
+    // Uncapped falls back on the other uncapped mode before settling for FIFO, which every surface has
+    if (requestedPresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR && available(VK_PRESENT_MODE_MAILBOX_KHR)) return VK_PRESENT_MODE_MAILBOX_KHR;
+
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+bool PresentationManager::supportsPresentMode(const VkPresentModeKHR mode) const
+{
+    return std::find(swapChainSupport.presentModes.begin(), swapChainSupport.presentModes.end(), mode) != swapChainSupport.presentModes.end();
+}
+
+VkResult PresentationManager::present(VkQueue presentQueue, VkSemaphore waitSemaphore, const uint32_t imageIndex)
+{
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &waitSemaphore;
+
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &swapChain;
+    presentInfo.pImageIndices = &imageIndex;
+
+    const uint64_t id = presentId + 1;
+
+    VkPresentIdKHR presentIdInfo{};
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &id;
+
+    VkSwapchainPresentFenceInfoEXT presentFenceInfo{};
+    presentFenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT;
+    presentFenceInfo.swapchainCount = 1;
+
+    const void** next = &presentInfo.pNext;
+    if (presentWait)
+    {
+        *next = &presentIdInfo;
+        next = &presentIdInfo.pNext;
+        presentId = id;
+    }
 
-    for (size_t i = 0; i < swapChainImageViews.size(); i++)
+    VkFence fence = VK_NULL_HANDLE;
+    if (swapchainMaintenance)
     {
-        const VkImageView attachments[] = {
-            swapChainImageViews[i]
-        };
-
-        VkFramebufferCreateInfo frameBufferInfo{};
-        frameBufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        frameBufferInfo.renderPass = renderPass;
-        frameBufferInfo.attachmentCount = 1;
-        frameBufferInfo.pAttachments = attachments;
-        frameBufferInfo.width = swapChainExtent.width;
-        frameBufferInfo.height = swapChainExtent.height;
-        frameBufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(device, &frameBufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create framebuffer!");
+        fence = takePresentFence();
+        presentFenceInfo.pFences = &fence;
+        *next = &presentFenceInfo;
     }
+
+    const VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+
+    // Out of date and suboptimal presents still signal their fence, other errors end the app anyway
+    if (fence) presentFences.push_back({ fence, swapChain });
+
+    return result;
 }
 
-VkSurfaceFormatKHR PresentationManager::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+VkFence PresentationManager::takePresentFence()
 {
-    for (const auto& availableFormat : availableFormats)
+    if (!freePresentFences.empty())
     {
-        if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
-            return availableFormat;
+        const VkFence fence = freePresentFences.back();
+        freePresentFences.pop_back();
+        return fence;
     }
 
-    return availableFormats[0];
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a present fence!");
+
+    return fence;
 }
-VkPresentModeKHR PresentationManager::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+
+void PresentationManager::retireSwapChain(VkSwapchainKHR oldSwapChain)
 {
-    for (const auto& availablePresentMode : availablePresentModes)
+    // Without present fences there is no telling when its last present is done. The fence of the last frame presented
+    // to it is as close as it gets, since that present waited on the frame.
+    if (!swapchainMaintenance)
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-            return availablePresentMode;
+        DeletionQueue::getInstance()->push([device = device, oldSwapChain] { vkDestroySwapchainKHR(device, oldSwapChain, nullptr); });
+        return;
     }
 
-    return VK_PRESENT_MODE_FIFO_KHR;
+    retiredSwapChains.push_back(oldSwapChain);
+}
+
+void PresentationManager::releaseRetired()
+{
+    while (!presentFences.empty() && vkGetFenceStatus(device, presentFences.front().fence) == VK_SUCCESS)
+    {
+        vkResetFences(device, 1, &presentFences.front().fence);
+        freePresentFences.push_back(presentFences.front().fence);
+        presentFences.pop_front();
+    }
+
+    std::erase_if(retiredSwapChains, [this](const VkSwapchainKHR retired)
+    {
+        for (const PresentFence& present : presentFences) if (present.swapChain == retired) return false;
+
+        vkDestroySwapchainKHR(device, retired, nullptr);
+        return true;
+    });
+}
+
+void PresentationManager::waitForPresent(const uint64_t lag)
+{
+    if (!presentWait || presentId <= lag) return;
+
+    // Bounded, so a minimised window or a lost surface cannot hang the frame. Whatever went wrong shows up at the next acquire or present.
+    constexpr uint64_t timeout = 100'000'000;
+    waitForPresentKHR(device, swapChain, presentId - lag, timeout);
 }
 VkExtent2D PresentationManager::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 {
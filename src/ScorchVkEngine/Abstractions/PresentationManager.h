@@ -3,6 +3,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <iostream>
 #include <GLFW/glfw3.h>
+#include <deque>
 #include <optional>
 #include <vector>
 
@@ -12,6 +13,22 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Enabled when the device lists it, see createLogicalDevice
+const std::vector<const char*> dynamicRenderingExtensions = {
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME
+};
+
+// Enabled together when the device has both
+const std::vector<const char*> presentWaitExtensions = {
+    VK_KHR_PRESENT_ID_EXTENSION_NAME,
+    VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+};
+
+// Fences every present, so a retired swap chain can be destroyed as soon as its last present is done with
+const std::vector<const char*> swapchainMaintenanceExtensions = {
+    VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME
+};
+
 struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
@@ -44,41 +61,99 @@ public:
 
     QueueFamilyIndices _indices;
 
+    // Optional features, enabled when the device has them
+    bool drawIndirectCount = false;
+    bool largePoints = false;
+    float maxPointSize = 1.0f;
+
+    // Set before the device is, and fixed from then on. Every per frame resource, from command pools and sync objects
+    // to uniform and instance buffers and descriptor sets, comes in framesInFlight copies: more of them let the CPU run
+    // further ahead of the GPU, for throughput at the cost of latency.
+    static constexpr uint32_t maxFramesInFlight = 8;
+    uint32_t framesInFlight = 2;
+    static constexpr uint32_t maxRequestedImageCount = 8;
+    uint32_t requestedImageCount = 0; // Zero for one more than the surface's minimum, clamped to what it allows
+    uint32_t minImageCount = 2;       // The surface's minimum
+    uint32_t imageCount = 0;          // What the swap chain was created with
+
+    // VK_KHR_present_wait, which lets frames be paced to when the previous ones reach the screen
+    bool presentWait = false;
+
+    // VK_EXT_swapchain_maintenance1, without it a retired swap chain waits on the fence of the last frame presented to it
+    bool swapchainMaintenance = false;
+
+    // Picked from the GUI, the swap chain falls back to FIFO when the surface does not have it
+    VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR; // What the swap chain was created with
+
+    // Zero when the graphics queue cannot write timestamps
+    uint32_t timestampValidBits = 0;
+    float timestampPeriod = 1.0f; // Nanoseconds per tick
+
     VkSwapchainKHR swapChain{};
     VkFormat swapChainImageFormat{};
     VkExtent2D swapChainExtent{};
-    std::vector<VkFramebuffer> swapChainFramebuffers;
+    // Rendered to directly with dynamic rendering, so there are no framebuffers
+    std::vector<VkImage> swapChainImages;
+    std::vector<VkImageView> swapChainImageViews;
 
     bool frameBufferResized = false;
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
     void setUpPresentation(VkInstance instance, GLFWwindow* window, ValidationLayers& vLayers, VkQueue& gfxQ, VkQueue& prstQ);
+    // Without a window, surface or swap chain, for rendering offscreen. The swap chain format and extent are those of
+    // the offscreen target instead.
+    void setUpHeadless(VkInstance instance, ValidationLayers& vLayers, VkQueue& gfxQ, VkExtent2D extent, VkFormat format);
     void destroyPresentation(VkInstance instance);
 
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice& device);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice& device);
     static bool checkDeviceExtensionSupport(VkPhysicalDevice& device);
+    static bool checkDeviceExtensionSupport(VkPhysicalDevice& device, const std::vector<const char*>& extensions);
+    bool supportsPresentMode(VkPresentModeKHR mode) const;
+
+    // Presents the image, numbered for present wait when it is enabled
+    VkResult present(VkQueue presentQueue, VkSemaphore waitSemaphore, uint32_t imageIndex);
+
+    // Blocks until every present but the last lag ones is on screen. Does nothing without present wait.
+    void waitForPresent(uint64_t lag);
+
+    // Destroys the retired swap chains whose presents have all finished, once a frame
+    void releaseRetired();
 
     // SwapChain Related
     void cleanupSwapChain();
-    void recreateSwapChain(VkRenderPass renderPass);
-    void createFramebuffers(VkRenderPass renderPass);
+    // Never waits for the device: what frames in flight may still use goes on the deletion queue
+    void recreateSwapChain();
 
     static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 private:
     PresentationManager() {}
 
-    std::vector<VkImage> swapChainImages;
-    std::vector<VkImageView> swapChainImageViews;
-
     SwapChainSupportDetails swapChainSupport{};
 
+    PFN_vkWaitForPresentKHR waitForPresentKHR = nullptr;
+    uint64_t presentId = 0; // Of the last present to the current swap chain
+
+    struct PresentFence
+    {
+        VkFence fence;
+        VkSwapchainKHR swapChain;
+    };
+    std::deque<PresentFence> presentFences; // Presents still in flight, oldest first
+    std::vector<VkFence> freePresentFences;
+    std::vector<VkSwapchainKHR> retiredSwapChains;
+
+    VkFence takePresentFence();
+    void retireSwapChain(VkSwapchainKHR oldSwapChain);
+
     // Device Related
     bool isDeviceSuitable(VkPhysicalDevice& device);
+    static bool supportsRequiredFeatures(VkPhysicalDevice& device); // Dynamic rendering and synchronization2
     void pickPhysicalDevice(VkInstance instance);
     void createLogicalDevice(ValidationLayers vLayers, VkQueue& gfxQ, VkQueue& prstQ);
 
@@ -0,0 +1,140 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+Profiler* Profiler::instance = new Profiler();
+
+Profiler::ThreadLog& Profiler::addThread()
+{
+    std::lock_guard lock(logsMutex);
+
+    logs.emplace_back(std::make_unique<ThreadLog>());
+    currentLog = logs.back().get();
+
+    return *currentLog;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadLog& log = threadLog();
+
+    std::lock_guard lock(logsMutex);
+    strncpy(log.name, name, threadNameLength - 1);
+    log.name[threadNameLength - 1] = '\0';
+}
+
+void Profiler::recordGpu(const ProfileEvent* events, const uint32_t count)
+{
+    gpuEvents.assign(events, events + count);
+}
+
+void Profiler::addToHistory(const ProfileEvent& event)
+{
+    ScopeHistory& history = histories[event.name];
+    history.durations[history.next] = static_cast<float>(event.end - event.start) * 1e-6f;
+    history.next = (history.next + 1) % historyLength;
+    history.count = std::min(history.count + 1, historyLength);
+    history.frameCalls++;
+}
+
+void Profiler::endFrame()
+{
+    const uint64_t frameEnd = now();
+
+    for (auto& [name, history] : histories) history.frameCalls = 0;
+    if (!paused)
+    {
+        frame.start = frameStart;
+        frame.end = frameEnd;
+        frame.threads.clear();
+    }
+
+    // The GPU row keeps the last passes it was given until newer ones arrive
+    for (const ProfileEvent& event : gpuEvents)
+    {
+        addToHistory(event);
+        if (captureFrames) captured.push_back({ event.name, event.start, event.end, gpuThread });
+    }
+    if (!paused && !gpuEvents.empty()) frame.gpu.swap(gpuEvents);
+    gpuEvents.clear();
+
+    std::lock_guard lock(logsMutex);
+
+    for (uint32_t logIndex = 0; logIndex < logs.size(); logIndex++)
+    {
+        const std::unique_ptr<ThreadLog>& log = logs[logIndex];
+        const uint64_t head = log->head.load(std::memory_order_acquire);
+        const uint64_t first = std::max(log->tail, head > eventCapacity ? head - eventCapacity : 0);
+
+        drained.clear();
+        for (uint64_t i = first; i < head; i++) drained.push_back(log->events[i & (eventCapacity - 1)]);
+        log->tail = head;
+
+        // A thread that lapped its ring while it was being copied has written over the oldest events, drop them
+        const uint64_t lapped = log->head.load(std::memory_order_acquire);
+        if (lapped > first + eventCapacity) drained.erase(drained.begin(), drained.begin() + std::min<uint64_t>(lapped - first - eventCapacity, drained.size()));
+
+        ThreadFrame thread{ log->name, {} };
+
+        for (const ProfileEvent& event : drained)
+        {
+            addToHistory(event);
+            if (captureFrames) captured.push_back({ event.name, event.start, event.end, logIndex });
+
+            if (!paused && event.end > frameStart)
+            {
+                thread.events.push_back(event);
+                thread.depthCount = std::max(thread.depthCount, event.depth + 1);
+            }
+        }
+
+        if (!paused && !thread.events.empty()) frame.threads.push_back(std::move(thread));
+    }
+
+    frameStart = frameEnd;
+
+    if (captureFrames && --captureFrames == 0)
+    {
+        // The GPU gets the row after the last thread
+        std::vector<std::string> threadNames;
+        for (const std::unique_ptr<ThreadLog>& log : logs) threadNames.emplace_back(log->name);
+        for (TraceEvent& event : captured) if (event.thread == gpuThread) event.thread = static_cast<uint32_t>(threadNames.size());
+        threadNames.emplace_back("GPU");
+
+        traceWriter.write(capturePath, std::move(threadNames), std::move(captured));
+        captured = {};
+    }
+}
+
+void Profiler::startCapture(const uint32_t frames, const std::string& path)
+{
+    captureFrames = frames;
+    capturePath = path;
+
+    // About what a frame records, so capturing does not keep growing the buffer
+    captured.clear();
+    captured.reserve(static_cast<size_t>(frames) * 512);
+}
+
+std::vector<std::pair<std::string_view, Profiler::ScopeStats>> Profiler::getStats() const
+{
+    std::vector<std::pair<std::string_view, ScopeStats>> stats;
+    stats.reserve(histories.size());
+
+    float sorted[historyLength];
+
+    for (const auto& [name, history] : histories)
+    {
+        std::copy_n(history.durations, history.count, sorted);
+        std::sort(sorted, sorted + history.count);
+
+        float total = 0.0f;
+        for (uint32_t i = 0; i < history.count; i++) total += sorted[i];
+
+        const uint32_t p99Index = std::min(history.count - 1, history.count * 99 / 100);
+        stats.push_back({ name, { sorted[0], total / static_cast<float>(history.count), sorted[p99Index], history.frameCalls } });
+    }
+
+    return stats;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Abstractions/TraceWriter.h>
+
+// Debug builds are profiled, release builds only when SCORCH_PROFILING is defined. Without it the markers expand to
+// nothing at all.
+#if !defined(NDEBUG) && !defined(SCORCH_PROFILING)
+#define SCORCH_PROFILING
+#endif
+
+#ifdef SCORCH_PROFILING
+#define SCORCH_PROFILE_CONCAT_INNER(a, b) a##b
+#define SCORCH_PROFILE_CONCAT(a, b) SCORCH_PROFILE_CONCAT_INNER(a, b)
+#define SCORCH_PROFILE_SCOPE(name) const ProfileScope SCORCH_PROFILE_CONCAT(profileScope, __LINE__){name}
+#define SCORCH_PROFILE_THREAD(name) Profiler::getInstance()->setThreadName(name)
+#else
+#define SCORCH_PROFILE_SCOPE(name)
+#define SCORCH_PROFILE_THREAD(name)
+#endif
+
+// One closed scope. Names are string literals, so events only ever point at them.
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t start, end; // Nanoseconds on the steady clock
+    uint32_t depth;      // Scopes open around this one on the same thread
+};
+
+// Hierarchical CPU profiler. Every thread writes the scopes it closes into a ring buffer of its own, allocated the first
+// time it records, so a marker costs two clock reads and a store. Once per frame the render thread drains the rings
+// into the last frame's flame graph and into a rolling history of durations per scope.
+class Profiler
+{
+public:
+    // Created before main, since job system workers record from the moment they start
+    static Profiler* instance;
+    static Profiler* getInstance()
+    {
+        if (!instance) instance = new Profiler();
+        return instance;
+    }
+
+    static constexpr uint32_t eventCapacity = 1 << 13; // Per thread, a power of two
+    static constexpr uint32_t historyLength = 256;    // Calls kept per scope for the statistics
+    static constexpr uint32_t threadNameLength = 32;
+    static constexpr uint32_t defaultCaptureFrames = 300;
+
+    struct ThreadFrame
+    {
+        const char* name;
+        std::vector<ProfileEvent> events;
+        uint32_t depthCount = 0;
+    };
+
+    // Everything that closed between the last two calls to endFrame
+    struct Frame
+    {
+        uint64_t start = 0, end = 0;
+        std::vector<ThreadFrame> threads;
+        std::vector<ProfileEvent> gpu; // The newest GPU passes, placed at the time their frame was recorded
+    };
+
+    struct ScopeStats
+    {
+        float min, avg, p99; // Milliseconds, over the last historyLength calls
+        uint32_t calls;      // In the last frame
+    };
+
+    bool paused = false; // Keeps the flame graph on the frame it shows, the statistics carry on
+
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void setThreadName(const char* name);
+
+    void record(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+    {
+        ThreadLog& log = threadLog();
+        const uint64_t head = log.head.load(std::memory_order_relaxed);
+
+        log.events[head & (eventCapacity - 1)] = { name, start, end, depth };
+        log.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Opens and closes a scope on the calling thread, returning the depth it opened at
+    uint32_t push() { return threadLog().depth++; }
+    void pop() { threadLog().depth--; }
+
+    // GPU passes of a frame that has finished, arriving frames late. The GPU clock is not the CPU one, so the passes
+    // are placed at the CPU time their frame was recorded and shown in a row of their own. Render thread only.
+    void recordGpu(const ProfileEvent* events, uint32_t count);
+
+    // Called by the render thread once per frame
+    void endFrame();
+
+    // Keeps every event of the next frames, then writes them out as a Chrome trace. Render thread only.
+    void startCapture(uint32_t frames, const std::string& path);
+    bool isCapturing() const { return captureFrames > 0; }
+
+    // Waits for the last capture to be written
+    void shutdown() { traceWriter.finish(); }
+
+    const Frame& getFrame() const { return frame; }
+    std::vector<std::pair<std::string_view, ScopeStats>> getStats() const;
+
+private:
+    struct ThreadLog
+    {
+        char name[threadNameLength] = "Thread";
+        ProfileEvent events[eventCapacity];
+        std::atomic<uint64_t> head{0}; // Events ever recorded
+        uint64_t tail = 0;             // Events drained by endFrame
+        uint32_t depth = 0;
+    };
+
+    struct ScopeHistory
+    {
+        float durations[historyLength];
+        uint32_t count = 0;
+        uint32_t next = 0;
+        uint32_t frameCalls = 0;
+    };
+
+    Profiler() {}
+
+    // Logs are never freed, so a thread that exits leaves nothing dangling behind
+    std::mutex logsMutex;
+    std::vector<std::unique_ptr<ThreadLog>> logs;
+
+    uint64_t frameStart = now();
+    Frame frame;
+    std::vector<ProfileEvent> drained;
+    std::vector<ProfileEvent> gpuEvents;
+    std::map<std::string_view, ScopeHistory> histories;
+
+    uint32_t captureFrames = 0;
+    std::string capturePath;
+    std::vector<TraceEvent> captured;
+    TraceWriter traceWriter;
+
+    static constexpr uint32_t gpuThread = UINT32_MAX; // Stands in for the GPU among captured threads
+
+    void addToHistory(const ProfileEvent& event);
+
+    inline static thread_local ThreadLog* currentLog = nullptr;
+
+    ThreadLog& threadLog() { return currentLog ? *currentLog : addThread(); }
+    ThreadLog& addThread();
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : name(name), depth(Profiler::getInstance()->push()), start(Profiler::now()) {}
+
+    ~ProfileScope()
+    {
+        Profiler* profiler = Profiler::getInstance();
+        profiler->record(name, start, Profiler::now(), depth);
+        profiler->pop();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint32_t depth;
+    uint64_t start;
+};
@@ -1,9 +1,12 @@
-#define MAX_FRAMES_IN_FLIGHT 2
 #include "BufferManager.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <vma/vk_mem_alloc.h>
 
+#include <Abstractions/DeletionQueue.h>
+#include <Abstractions/Profiler.h>
+
 BufferManager* BufferManager::instance = nullptr;
 
 void BufferManager::createDescriptorSetLayout()
@@ -34,13 +37,13 @@ void BufferManager::createDescriptorPool()
 {
     VkDescriptorPoolSize poolSize{};
     poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolSize.descriptorCount = presentMan->framesInFlight;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = 1;
     poolInfo.pPoolSizes = &poolSize;
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolInfo.maxSets = presentMan->framesInFlight;
 
     if (vkCreateDescriptorPool(presentMan->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create a descriptor pool!");
@@ -48,18 +51,18 @@ void BufferManager::createDescriptorPool()
 
 void BufferManager::createDescriptorSets()
 {
-    const std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    const std::vector<VkDescriptorSetLayout> layouts(presentMan->framesInFlight, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.descriptorSetCount = presentMan->framesInFlight;
     allocInfo.pSetLayouts = layouts.data();
 
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    descriptorSets.resize(presentMan->framesInFlight);
     if (vkAllocateDescriptorSets(presentMan->device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
         throw std::runtime_error("Failed to allocate descriptor sets!");
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
     {
         VkDescriptorBufferInfo bufferInfo{};
         bufferInfo.buffer = uniformBuffers[i];
@@ -83,7 +86,7 @@ void BufferManager::setUpBufferManager(VkInstance instance, const std::vector<Ve
 {
     VMA.createAllocator(instance);
     createVertexArrayObject(vertices, indices, commandPool, gfxQueue);
-    createInstanceBuffers(instances, commandPool, gfxQueue);
+    createInstanceBuffers(instances);
     createUniformBuffers();
 
     createDescriptorPool();
@@ -108,11 +111,12 @@ void BufferManager::createUniformBuffers()
 {
     constexpr VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    uniformBuffers.resize(presentMan->framesInFlight);
+    uniformBuffersAllocation.resize(presentMan->framesInFlight);
+    uniformBuffersMapped.resize(presentMan->framesInFlight);
+    uniformBuffersVersion.assign(presentMan->framesInFlight, 0);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
     {
         VMA.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersAllocation[i]);
         vmaMapMemory(VMA.allocator, uniformBuffersAllocation[i], &uniformBuffersMapped[i]);
@@ -131,63 +135,80 @@ void BufferManager::destroyImguiFontBuffer(VkImage fontImage)
     vmaFreeMemory(VMA.allocator, imguiFontAllocation);
 }
 
-void BufferManager::updateUniformBuffers(GLFWwindow* window, uint32_t currentImage)
+void BufferManager::setUniformBufferObject(const UniformBufferObject& ubo)
 {
-    UniformBufferObject ubo{};
-    ubo.model = translate(glm::mat4(1.0f), glm::vec3(0.0f));
-    ubo.view =  translate(glm::mat4(1.0f), glm::vec3(0.0f));
-
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-
-    const float windowHalfWidth = width * 0.5f;
-    const float windowHalfHeight = height * 0.5f;
+    uniformBufferObject = ubo;
+    uniformVersion++;
+}
 
-    ubo.proj = glm::ortho(-windowHalfWidth / 10, windowHalfWidth / 10, -windowHalfHeight / 10, windowHalfHeight / 10, -1.0f, 1.0f);
-    ubo.proj[1][1] *= -1;
+void BufferManager::updateUniformBuffers(uint32_t currentImage)
+{
+    if (uniformBuffersVersion[currentImage] == uniformVersion) return;
 
-    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+    memcpy(uniformBuffersMapped[currentImage], &uniformBufferObject, sizeof(uniformBufferObject));
+    uniformBuffersVersion[currentImage] = uniformVersion;
 }
 
 void BufferManager::destroyUniformBuffers()
 {
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
     {
         vmaUnmapMemory(VMA.allocator, uniformBuffersAllocation[i]);
         vmaDestroyBuffer(VMA.allocator, uniformBuffers[i], uniformBuffersAllocation[i]);
     }
 }
 
-void BufferManager::createInstanceBuffers(const std::vector<VertexInstance>& instances, VkCommandPool& commandPool, VkQueue gfxQueue)
+void BufferManager::createInstanceBuffers(const std::vector<VertexInstance>& instances)
 {
-    commPool =  commandPool;
-    const VkDeviceSize bufferSize = sizeof(VertexInstance) * instances.size();
+    instanceBuffers.resize(presentMan->framesInFlight);
+    instanceBufferAllocations.resize(presentMan->framesInFlight);
+    instanceBuffersMapped.resize(presentMan->framesInFlight);
+    instanceBufferCapacities.assign(presentMan->framesInFlight, 0);
 
-    VkBuffer stagingBuffer;
-    VmaAllocation stagingBufferAllocation;
-    VMA.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferAllocation);
+    for (uint32_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        createInstanceBuffer(i, instances.size());
+        memcpy(instanceBuffersMapped[i], instances.data(), sizeof(VertexInstance) * instances.size());
+    }
+}
 
-    void* bufferData;
-    vmaMapMemory(VMA.allocator, stagingBufferAllocation, &bufferData);
-    memcpy(bufferData, instances.data(), bufferSize);
-    vmaUnmapMemory(VMA.allocator, stagingBufferAllocation);
+bool BufferManager::reserveInstanceBuffer(const uint32_t currentFrame, const size_t count)
+{
+    if (count <= instanceBufferCapacities[currentFrame]) return false;
 
-    VMA.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, instanceBufferAllocation);
+    // Grown geometrically, so spawning a few bodies every frame reallocates now and then rather than every frame
+    destroyInstanceBuffer(currentFrame);
+    createInstanceBuffer(currentFrame, std::max(count, instanceBufferCapacities[currentFrame] * 2));
+    return true;
+}
 
-    VMA.copyBuffer(commPool, gfxQueue, stagingBuffer, instanceBuffer, bufferSize);
+void BufferManager::createInstanceBuffer(const uint32_t frame, size_t capacity)
+{
+    capacity = std::max<size_t>(capacity, 1);
 
-    vmaDestroyBuffer(VMA.allocator, stagingBuffer, stagingBufferAllocation);
+    // Written through the mapping every frame, so there is nothing to stage
+    VMA.createBuffer(sizeof(VertexInstance) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffers[frame], instanceBufferAllocations[frame]);
+    vmaMapMemory(VMA.allocator, instanceBufferAllocations[frame], &instanceBuffersMapped[frame]);
 
-    vmaMapMemory(VMA.allocator, instanceBufferAllocation, &instanceBufferMapped);
+    instanceBufferCapacities[frame] = capacity;
+}
+
+void BufferManager::destroyInstanceBuffer(const uint32_t frame)
+{
+    DeletionQueue::getInstance()->push([allocator = VMA.allocator, buffer = instanceBuffers[frame], allocation = instanceBufferAllocations[frame]]
+    {
+        vmaUnmapMemory(allocator, allocation);
+        vmaDestroyBuffer(allocator, buffer, allocation);
+    });
 }
 
-void BufferManager::updateInstanceBuffers(const std::vector<VertexInstance>& instances)
+void BufferManager::updateInstanceBuffers(const std::vector<VertexInstance>& instances, const uint32_t currentFrame)
 {
-    memcpy(instanceBufferMapped, instances.data(), sizeof(VertexInstance) * instances.size());
+    SCORCH_PROFILE_SCOPE("updateInstanceBuffers");
+    memcpy(instanceBuffersMapped[currentFrame], instances.data(), sizeof(VertexInstance) * instances.size());
 }
 
 void BufferManager::destroyInstanceBuffers()
 {
-    vmaUnmapMemory(VMA.allocator, instanceBufferAllocation);
-    vmaDestroyBuffer(VMA.allocator, instanceBuffer, instanceBufferAllocation);
+    for (uint32_t i = 0; i < instanceBuffers.size(); i++) destroyInstanceBuffer(i);
 }
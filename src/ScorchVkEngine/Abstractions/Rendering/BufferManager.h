@@ -52,26 +52,33 @@ struct Vertex
 struct VertexInstance
 {
     glm::vec3 modelPos;
+    float scale = 1.0f; // Multiplies the unit quad, i.e. the body's diameter
 
-    static VkVertexInputBindingDescription getBindingDescription()
+    // Point sprites step through the instances per vertex instead
+    static VkVertexInputBindingDescription getBindingDescription(const VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_INSTANCE)
     {
         VkVertexInputBindingDescription bindingDescription{};
         bindingDescription.binding = 1;
         bindingDescription.stride = sizeof(VertexInstance);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        bindingDescription.inputRate = inputRate;
 
         return bindingDescription;
     }
 
     static std::vector<VkVertexInputAttributeDescription> getAttributeDescription()
     {
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{1};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{2};
 
         attributeDescriptions[0].binding = 1;
         attributeDescriptions[0].location = 3;
         attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
         attributeDescriptions[0].offset = offsetof(VertexInstance, modelPos);
 
+        attributeDescriptions[1].binding = 1;
+        attributeDescriptions[1].location = 4;
+        attributeDescriptions[1].format = VK_FORMAT_R32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(VertexInstance, scale);
+
         return attributeDescriptions;
     }
 };
@@ -98,8 +105,9 @@ public:
     VulkanMemoryAllocator VMA;
     VkBuffer vertexBuffer{};
     VkBuffer indexBuffer{};
-    VkBuffer instanceBuffer{};
-    void* instanceBufferMapped{};
+    // Per frame in flight, so a frame is never written while the GPU still reads the one before it
+    std::vector<VkBuffer> instanceBuffers;
+    std::vector<void*> instanceBuffersMapped;
     VkBuffer imguiImageBuffer{};
     std::vector<VkBuffer> uniformBuffers;
     std::vector<void*> uniformBuffersMapped;
@@ -110,12 +118,16 @@ public:
     void setUpBufferManager(VkInstance instance, const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices, const std::vector<VertexInstance>& instances, VkCommandPool& commandPool, VkQueue gfxQueue);
     void destroyBufferManager();
 
-    void updateUniformBuffers(GLFWwindow* window, uint32_t currentImage);
+    // Takes new UBO contents. A frame's buffer is only rewritten when it comes around with older contents than these.
+    void setUniformBufferObject(const UniformBufferObject& ubo);
+    void updateUniformBuffers(uint32_t currentImage);
     void destroyUniformBuffers();
 
-    void createInstanceBuffers(const std::vector<VertexInstance>& instances, VkCommandPool& commandPool, VkQueue gfxQueue);
-    void updateInstanceBuffers(const std::vector<VertexInstance>& instances);
-    void destroyInstanceBuffers();
+    void createInstanceBuffers(const std::vector<VertexInstance>& instances);
+    // Grows the frame's buffer to hold count instances, true when it was replaced. Only once the frame's fence has signalled.
+    bool reserveInstanceBuffer(uint32_t currentFrame, size_t count);
+    void updateInstanceBuffers(const std::vector<VertexInstance>& instances, uint32_t currentFrame);
+    void destroyInstanceBuffers(); // Deferred to the deletion queue
 
     void createImguiFontBuffer(const VkImage& fontImage, VkQueue gfxQueue);
     void destroyImguiFontBuffer(VkImage fontImage);
@@ -127,8 +139,12 @@ private:
 
     VmaAllocation vertexBufferAllocation{};
     VmaAllocation indexBufferAllocation{};
-    VmaAllocation instanceBufferAllocation{};
+    std::vector<VmaAllocation> instanceBufferAllocations;
+    std::vector<size_t> instanceBufferCapacities; // In instances
     std::vector<VmaAllocation> uniformBuffersAllocation;
+    UniformBufferObject uniformBufferObject{};
+    uint64_t uniformVersion = 0;
+    std::vector<uint64_t> uniformBuffersVersion; // Of the contents each frame's buffer holds
     VmaAllocation imguiFontAllocation{};
 
     VkDescriptorPool descriptorPool{};
@@ -139,6 +155,8 @@ private:
 
     void createVertexArrayObject(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices, VkCommandPool& commandPool, VkQueue gfxQueue);
     void createUniformBuffers();
+    void createInstanceBuffer(uint32_t frame, size_t capacity);
+    void destroyInstanceBuffer(uint32_t frame);
 
     template<typename T>
     void createVkBuffer(const std::vector<T>& data, VkBuffer& buffer, VmaAllocation& bufferAllocation, VkBufferUsageFlags usage, VkCommandPool& commandPool, VkQueue gfxQueue)
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Pans and zooms over the world. At a zoom of one, a world unit spans basePixelsPerUnit framebuffer pixels, which is
+// what the fixed projection used to be.
+struct Camera
+{
+    static constexpr float basePixelsPerUnit = 10.0f;
+    static constexpr float minZoom = 0.005f;
+    static constexpr float maxZoom = 100.0f;
+
+    glm::vec2 centre{0.0f};
+    float zoom = 1.0f;
+
+    bool operator==(const Camera& other) const = default;
+
+    float pixelsPerUnit() const { return basePixelsPerUnit * zoom; }
+
+    glm::mat4 view() const { return glm::translate(glm::mat4(1.0f), glm::vec3(-centre, 0.0f)); }
+
+    glm::mat4 projection(const float width, const float height) const
+    {
+        const float halfWidth = 0.5f * width / pixelsPerUnit();
+        const float halfHeight = 0.5f * height / pixelsPerUnit();
+
+        glm::mat4 proj = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, -1.0f, 1.0f);
+        proj[1][1] *= -1;
+
+        return proj;
+    }
+
+    // Moves the world along with a cursor that moved by delta framebuffer pixels, y pointing down
+    void pan(const glm::vec2 delta) { centre += glm::vec2(-delta.x, delta.y) / pixelsPerUnit(); }
+
+    // Zooms by factor, keeping the world point under the cursor where it is
+    void zoomAt(const glm::vec2 cursor, const glm::vec2 framebufferSize, const float factor)
+    {
+        const glm::vec2 offset = { cursor.x - 0.5f * framebufferSize.x, 0.5f * framebufferSize.y - cursor.y };
+        const glm::vec2 anchor = centre + offset / pixelsPerUnit();
+
+        zoom = glm::clamp(zoom * factor, minZoom, maxZoom);
+        centre = anchor - offset / pixelsPerUnit();
+    }
+};
@@ -0,0 +1,260 @@
+#include "DensitySplatter.h"
+
+#include <array>
+#include <stdexcept>
+
+#include <Abstractions/Rendering/Shader.h>
+#include <Abstractions/DeletionQueue.h>
+
+void DensitySplatter::createSplatter()
+{
+    createDescriptorSetLayout();
+    createPipeline();
+    createDescriptorSets();
+
+    instanceCounts.assign(presentMan->framesInFlight, 0);
+}
+
+void DensitySplatter::destroySplatter()
+{
+    vkDestroyPipeline(presentMan->device, pipeline, nullptr);
+    vkDestroyPipelineLayout(presentMan->device, pipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(presentMan->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(presentMan->device, descriptorSetLayout, nullptr);
+}
+
+void DensitySplatter::createImages(const VkExtent2D imageExtent)
+{
+    images.resize(presentMan->framesInFlight);
+    imageAllocations.resize(presentMan->framesInFlight);
+    imageViews.resize(presentMan->framesInFlight);
+    extents.resize(presentMan->framesInFlight);
+
+    for (uint32_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        createImage(i, imageExtent);
+        writeDescriptorSet(i);
+    }
+}
+
+void DensitySplatter::destroyImages()
+{
+    for (uint32_t i = 0; i < images.size(); i++) destroyImage(i);
+}
+
+void DensitySplatter::setInstances(const uint32_t currentFrame, const uint32_t count, const bool instanceBufferChanged)
+{
+    instanceCounts[currentFrame] = count;
+    if (instanceBufferChanged) writeDescriptorSet(currentFrame);
+}
+
+void DensitySplatter::setExtent(const uint32_t currentFrame, const VkExtent2D extent)
+{
+    if (extent.width == extents[currentFrame].width && extent.height == extents[currentFrame].height) return;
+
+    destroyImage(currentFrame);
+    createImage(currentFrame, extent);
+    writeDescriptorSet(currentFrame);
+}
+
+void DensitySplatter::createImage(const uint32_t frame, const VkExtent2D imageExtent)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_UINT;
+    imageInfo.extent = { imageExtent.width, imageExtent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    if (vmaCreateImage(bufferMan->VMA.allocator, &imageInfo, &allocCreateInfo, &images[frame], &imageAllocations[frame], nullptr) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a density image!");
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = images[frame];
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_UINT;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    if (vkCreateImageView(presentMan->device, &viewInfo, nullptr, &imageViews[frame]) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a density image view!");
+
+    extents[frame] = imageExtent;
+}
+
+void DensitySplatter::destroyImage(const uint32_t frame)
+{
+    DeletionQueue::getInstance()->push([device = presentMan->device, allocator = bufferMan->VMA.allocator, view = imageViews[frame], image = images[frame], allocation = imageAllocations[frame]]
+    {
+        vkDestroyImageView(device, view, nullptr);
+        vmaDestroyImage(allocator, image, allocation);
+    });
+}
+
+void DensitySplatter::recordSplat(VkCommandBuffer commandBuffer, const uint32_t currentFrame) const
+{
+    constexpr VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    // Last frame's counts are thrown away, so the image can come from any layout
+    VkImageMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = 0;
+    clearBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    clearBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.image = images[currentFrame];
+    clearBarrier.subresourceRange = range;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &clearBarrier);
+
+    constexpr VkClearColorValue zero{};
+    vkCmdClearColorImage(commandBuffer, images[currentFrame], VK_IMAGE_LAYOUT_GENERAL, &zero, 1, &range);
+
+    VkImageMemoryBarrier splatBarrier = clearBarrier;
+    splatBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    splatBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    splatBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &splatBarrier);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+    const uint32_t instanceCount = instanceCounts[currentFrame];
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(instanceCount), &instanceCount);
+
+    vkCmdDispatch(commandBuffer, (instanceCount + workGroupSize - 1) / workGroupSize, 1, 1);
+
+    VkImageMemoryBarrier readBarrier = splatBarrier;
+    readBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    readBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &readBarrier);
+}
+
+void DensitySplatter::createDescriptorSetLayout()
+{
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(presentMan->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the splat descriptor set layout!");
+}
+
+void DensitySplatter::createPipeline()
+{
+    Shader shader{"../res/spir-v/splat.spv"};
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(presentMan->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the splat pipeline layout!");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shader.shaderStages[0];
+    pipelineInfo.layout = pipelineLayout;
+
+    if (vkCreateComputePipelines(presentMan->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the splat pipeline!");
+
+    shader.destroyShader();
+}
+
+void DensitySplatter::createDescriptorSets()
+{
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = presentMan->framesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = presentMan->framesInFlight;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[2].descriptorCount = presentMan->framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = presentMan->framesInFlight;
+
+    if (vkCreateDescriptorPool(presentMan->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the splat descriptor pool!");
+
+    const std::vector<VkDescriptorSetLayout> layouts(presentMan->framesInFlight, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = presentMan->framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(presentMan->framesInFlight);
+    if (vkAllocateDescriptorSets(presentMan->device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate the splat descriptor sets!");
+}
+
+void DensitySplatter::writeDescriptorSet(const uint32_t frame)
+{
+    const VkDescriptorBufferInfo uboInfo = { bufferMan->uniformBuffers[frame], 0, sizeof(UniformBufferObject) };
+    const VkDescriptorBufferInfo instanceInfo = { bufferMan->instanceBuffers[frame], 0, VK_WHOLE_SIZE };
+    const VkDescriptorImageInfo imageInfo = { VK_NULL_HANDLE, imageViews[frame], VK_IMAGE_LAYOUT_GENERAL };
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+    for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+    {
+        descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[binding].dstSet = descriptorSets[frame];
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorCount = 1;
+    }
+
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[0].pBufferInfo = &uboInfo;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].pBufferInfo = &instanceInfo;
+    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    descriptorWrites[2].pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(presentMan->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
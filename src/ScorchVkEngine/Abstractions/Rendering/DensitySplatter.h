@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include <Abstractions/Rendering/BufferManager.h>
+#include <Abstractions/PresentationManager.h>
+
+// Level of detail for when bodies are smaller than a pixel. Rather than rasterising them, a compute pass counts how many
+// fall in every pixel of a density image, which a full screen pass then shades. Its cost is one atomic per body,
+// with no vertex work at all.
+class DensitySplatter
+{
+public:
+    static constexpr uint32_t workGroupSize = 256; // local_size_x of splat.comp
+
+    // Shared by the splat pass and the full screen pass that reads the image
+    VkDescriptorSetLayout descriptorSetLayout{};
+    std::vector<VkDescriptorSet> descriptorSets; // Per frame in flight
+
+    void createSplatter();
+    void destroySplatter();
+
+    // Sized to the swap chain, so each is recreated when its frame comes around after a resize
+    void createImages(VkExtent2D extent);
+    void destroyImages(); // Deferred to the deletion queue
+
+    // Both only once the frame's fence has signalled, when nothing in flight uses its descriptor set any more
+    void setInstances(uint32_t currentFrame, uint32_t count, bool instanceBufferChanged);
+    void setExtent(uint32_t currentFrame, VkExtent2D extent);
+
+    // Records the splat pass and the barrier the full screen pass waits on. Must be outside a render pass.
+    void recordSplat(VkCommandBuffer commandBuffer, uint32_t currentFrame) const;
+
+private:
+    PresentationManager* presentMan = PresentationManager::getInstance();
+    BufferManager* bufferMan = BufferManager::getInstance();
+
+    std::vector<uint32_t> instanceCounts; // Per frame in flight
+    std::vector<VkExtent2D> extents;
+
+    VkDescriptorPool descriptorPool{};
+
+    VkPipelineLayout pipelineLayout{};
+    VkPipeline pipeline{};
+
+    std::vector<VkImage> images;
+    std::vector<VmaAllocation> imageAllocations;
+    std::vector<VkImageView> imageViews;
+
+    void createDescriptorSetLayout();
+    void createPipeline();
+    void createDescriptorSets();
+    void createImage(uint32_t frame, VkExtent2D extent);
+    void destroyImage(uint32_t frame);
+    void writeDescriptorSet(uint32_t frame);
+};
@@ -0,0 +1,79 @@
+#include "GpuTimer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <Abstractions/Profiler.h>
+
+void GpuTimer::createTimer()
+{
+#ifdef SCORCH_PROFILING
+    if (presentMan->timestampValidBits == 0) return;
+
+    timestampMask = presentMan->timestampValidBits >= 64 ? ~0ull : (1ull << presentMan->timestampValidBits) - 1;
+    pending.assign(presentMan->framesInFlight, false);
+    recordTimes.assign(presentMan->framesInFlight, 0);
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = presentMan->framesInFlight * passCount * 2;
+
+    if (vkCreateQueryPool(presentMan->device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the timestamp query pool!");
+#endif
+}
+
+void GpuTimer::destroyTimer()
+{
+    if (queryPool) vkDestroyQueryPool(presentMan->device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+}
+
+void GpuTimer::reset(VkCommandBuffer commandBuffer, const uint32_t currentFrame)
+{
+    if (!queryPool) return;
+
+    vkCmdResetQueryPool(commandBuffer, queryPool, query(currentFrame, GpuPass::Compute, 0), passCount * 2);
+    pending[currentFrame] = true;
+    recordTimes[currentFrame] = Profiler::now();
+}
+
+void GpuTimer::begin(VkCommandBuffer commandBuffer, const uint32_t currentFrame, const GpuPass pass) const
+{
+    if (queryPool) vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query(currentFrame, pass, 0));
+}
+
+void GpuTimer::end(VkCommandBuffer commandBuffer, const uint32_t currentFrame, const GpuPass pass) const
+{
+    if (queryPool) vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, query(currentFrame, pass, 1));
+}
+
+void GpuTimer::collect(const uint32_t currentFrame)
+{
+    if (!queryPool || !pending[currentFrame]) return;
+    pending[currentFrame] = false;
+
+    uint64_t timestamps[passCount * 2];
+    if (vkGetQueryPoolResults(presentMan->device, queryPool, query(currentFrame, GpuPass::Compute, 0), passCount * 2, sizeof(timestamps),
+                              timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return;
+
+    // The GPU clock has nothing to do with the CPU one, so the frame starts when it was recorded. It cannot have started
+    // any sooner.
+    uint64_t first = timestamps[0] & timestampMask;
+    for (uint32_t i = 1; i < passCount * 2; i++) first = std::min(first, timestamps[i] & timestampMask);
+
+    const double period = presentMan->timestampPeriod;
+    ProfileEvent events[passCount];
+
+    for (uint32_t pass = 0; pass < passCount; pass++)
+    {
+        const uint64_t start = (timestamps[pass * 2] & timestampMask) - first;
+        const uint64_t end = (timestamps[pass * 2 + 1] & timestampMask) - first;
+
+        events[pass] = { passNames[pass], recordTimes[currentFrame] + static_cast<uint64_t>(static_cast<double>(start) * period),
+                         recordTimes[currentFrame] + static_cast<uint64_t>(static_cast<double>(std::max(start, end)) * period), 0 };
+    }
+
+    Profiler::getInstance()->recordGpu(events, passCount);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Abstractions/PresentationManager.h>
+
+// What the frame's timestamps are written around
+enum class GpuPass : uint32_t
+{
+    Compute, // The cull or splat pass, before the render pass
+    Scene,
+    Gui
+};
+
+// Timestamp queries around every pass of a frame. Each frame in flight has its own queries, which are read once its
+// fence has signalled, so the times reach the profiler framesInFlight frames late but without ever stalling.
+class GpuTimer
+{
+public:
+    static constexpr uint32_t passCount = 3;
+    static constexpr std::array<const char*, passCount> passNames = { "GPU Compute", "GPU Scene", "GPU Gui" };
+
+    // Does nothing where the graphics queue has no timestamps, or when profiling is compiled out
+    void createTimer();
+    void destroyTimer();
+
+    // Must be recorded into the primary buffer outside the render pass, before any pass of the frame
+    void reset(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+    // Safe to record from secondary buffers on any thread, each pass has queries of its own
+    void begin(VkCommandBuffer commandBuffer, uint32_t currentFrame, GpuPass pass) const;
+    void end(VkCommandBuffer commandBuffer, uint32_t currentFrame, GpuPass pass) const;
+
+    // Once the frame's fence has signalled, hands what its queries timed the last time round to the profiler
+    void collect(uint32_t currentFrame);
+
+private:
+    PresentationManager* presentMan = PresentationManager::getInstance();
+
+    VkQueryPool queryPool{};
+    uint64_t timestampMask = 0;
+    std::vector<bool> pending;          // Per frame in flight, whether its queries were submitted and not read yet
+    std::vector<uint64_t> recordTimes;  // Per frame in flight, the CPU time its passes are placed at
+
+    static uint32_t query(const uint32_t currentFrame, const GpuPass pass, const uint32_t edge)
+    {
+        return (currentFrame * passCount + static_cast<uint32_t>(pass)) * 2 + edge;
+    }
+};
@@ -0,0 +1,249 @@
+#include "InstanceCuller.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+#include <Abstractions/Rendering/Shader.h>
+#include <Abstractions/DeletionQueue.h>
+
+void InstanceCuller::createCuller(const uint32_t meshIndexCount)
+{
+    indexCount = meshIndexCount;
+
+    createDescriptorSetLayout();
+    createPipeline();
+    createDescriptorSets();
+
+    drawBuffers.resize(presentMan->framesInFlight);
+    drawAllocations.resize(presentMan->framesInFlight);
+
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        bufferMan->VMA.createBuffer(sizeof(CullDrawCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBuffers[i], drawAllocations[i]);
+    }
+}
+
+void InstanceCuller::destroyCuller()
+{
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
+        vmaDestroyBuffer(bufferMan->VMA.allocator, drawBuffers[i], drawAllocations[i]);
+
+    vkDestroyPipeline(presentMan->device, pipeline, nullptr);
+    vkDestroyPipelineLayout(presentMan->device, pipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(presentMan->device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(presentMan->device, descriptorSetLayout, nullptr);
+}
+
+void InstanceCuller::createVisibleBuffers(const uint32_t count)
+{
+    visibleBuffers.resize(presentMan->framesInFlight);
+    visibleAllocations.resize(presentMan->framesInFlight);
+    visibleCapacities.assign(presentMan->framesInFlight, 0);
+    instanceCounts.assign(presentMan->framesInFlight, count);
+
+    // One per frame in flight, so the cull pass never writes a buffer the previous frame is still drawing from
+    for (uint32_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        createVisibleBuffer(i, count);
+        writeDescriptorSet(i);
+    }
+}
+
+void InstanceCuller::destroyVisibleBuffers()
+{
+    for (uint32_t i = 0; i < visibleBuffers.size(); i++) destroyVisibleBuffer(i);
+}
+
+void InstanceCuller::setInstances(const uint32_t currentFrame, const uint32_t count, const bool instanceBufferChanged)
+{
+    instanceCounts[currentFrame] = count;
+
+    const bool grow = count > visibleCapacities[currentFrame];
+    if (grow)
+    {
+        destroyVisibleBuffer(currentFrame);
+        createVisibleBuffer(currentFrame, std::max(count, visibleCapacities[currentFrame] * 2));
+    }
+
+    // Nothing in flight uses this frame's set any more
+    if (grow || instanceBufferChanged) writeDescriptorSet(currentFrame);
+}
+
+void InstanceCuller::createVisibleBuffer(const uint32_t frame, uint32_t capacity)
+{
+    capacity = std::max(capacity, 1u);
+
+    bufferMan->VMA.createBuffer(sizeof(VertexInstance) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibleBuffers[frame], visibleAllocations[frame]);
+
+    visibleCapacities[frame] = capacity;
+}
+
+void InstanceCuller::destroyVisibleBuffer(const uint32_t frame)
+{
+    DeletionQueue::getInstance()->push([allocator = bufferMan->VMA.allocator, buffer = visibleBuffers[frame], allocation = visibleAllocations[frame]]
+    {
+        vmaDestroyBuffer(allocator, buffer, allocation);
+    });
+}
+
+void InstanceCuller::recordCull(VkCommandBuffer commandBuffer, const uint32_t currentFrame) const
+{
+    // Nothing is visible until the cull pass says so
+    CullDrawCommand reset{};
+    reset.command.indexCount = indexCount;
+    reset.points.instanceCount = 1;
+
+    vkCmdUpdateBuffer(commandBuffer, drawBuffers[currentFrame], 0, sizeof(reset), &reset);
+
+    VkMemoryBarrier resetBarrier{};
+    resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+    const uint32_t instanceCount = instanceCounts[currentFrame];
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(instanceCount), &instanceCount);
+
+    vkCmdDispatch(commandBuffer, (instanceCount + workGroupSize - 1) / workGroupSize, 1, 1);
+
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void InstanceCuller::drawIndirect(VkCommandBuffer commandBuffer, const uint32_t currentFrame) const
+{
+    // Without drawIndirectCount the command is still drawn, with however many instances survived
+    if (presentMan->drawIndirectCount)
+        vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffers[currentFrame], 0, drawBuffers[currentFrame], offsetof(CullDrawCommand, drawCount), 1, sizeof(CullDrawCommand));
+    else
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffers[currentFrame], 0, 1, sizeof(CullDrawCommand));
+}
+
+void InstanceCuller::drawPointsIndirect(VkCommandBuffer commandBuffer, const uint32_t currentFrame) const
+{
+    constexpr VkDeviceSize offset = offsetof(CullDrawCommand, points);
+
+    if (presentMan->drawIndirectCount)
+        vkCmdDrawIndirectCount(commandBuffer, drawBuffers[currentFrame], offset, drawBuffers[currentFrame], offsetof(CullDrawCommand, drawCount), 1, sizeof(CullDrawCommand));
+    else
+        vkCmdDrawIndirect(commandBuffer, drawBuffers[currentFrame], offset, 1, sizeof(CullDrawCommand));
+}
+
+void InstanceCuller::createDescriptorSetLayout()
+{
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(presentMan->device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the cull descriptor set layout!");
+}
+
+void InstanceCuller::createPipeline()
+{
+    Shader shader{"../res/spir-v/cull.spv"};
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(presentMan->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the cull pipeline layout!");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shader.shaderStages[0];
+    pipelineInfo.layout = pipelineLayout;
+
+    if (vkCreateComputePipelines(presentMan->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the cull pipeline!");
+
+    shader.destroyShader();
+}
+
+void InstanceCuller::createDescriptorSets()
+{
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = presentMan->framesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 3 * presentMan->framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = presentMan->framesInFlight;
+
+    if (vkCreateDescriptorPool(presentMan->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the cull descriptor pool!");
+
+    const std::vector<VkDescriptorSetLayout> layouts(presentMan->framesInFlight, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = presentMan->framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(presentMan->framesInFlight);
+    if (vkAllocateDescriptorSets(presentMan->device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate the cull descriptor sets!");
+}
+
+// Only rewrites this frame's set, once its fence has signalled, so no frame still in flight reads it
+void InstanceCuller::writeDescriptorSet(const uint32_t frame)
+{
+    const std::array<VkDescriptorBufferInfo, 4> bufferInfos = { {
+        { bufferMan->uniformBuffers[frame], 0, sizeof(UniformBufferObject) },
+        { bufferMan->instanceBuffers[frame], 0, VK_WHOLE_SIZE },
+        { visibleBuffers[frame], 0, VK_WHOLE_SIZE },
+        { drawBuffers[frame], 0, sizeof(CullDrawCommand) },
+    } };
+
+    std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+
+    for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+    {
+        descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[binding].dstSet = descriptorSets[frame];
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+    }
+
+    vkUpdateDescriptorSets(presentMan->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include <Abstractions/Rendering/BufferManager.h>
+#include <Abstractions/PresentationManager.h>
+
+// Matches the DrawCommand block of cull.comp. Both draws cover the same visible instances, one per renderer.
+struct CullDrawCommand
+{
+    VkDrawIndexedIndirectCommand command;
+    uint32_t drawCount;
+    VkDrawIndirectCommand points; // One vertex per instance
+};
+
+// GPU-driven culling. A compute pass tests every instance against the view volume of the frame's UBO, compacts the
+// visible ones into a buffer of their own and writes the indirect draw for them, so drawing scales with what is on
+// screen rather than with the body count.
+class InstanceCuller
+{
+public:
+    static constexpr uint32_t workGroupSize = 256; // local_size_x of cull.comp
+
+    std::vector<VkBuffer> visibleBuffers; // Per frame in flight
+    std::vector<VkBuffer> drawBuffers;    // Per frame in flight, one CullDrawCommand each
+
+    void createCuller(uint32_t meshIndexCount);
+    void destroyCuller();
+
+    // Sized to the instance buffers, so they grow along with them
+    void createVisibleBuffers(uint32_t count);
+    void destroyVisibleBuffers(); // Deferred to the deletion queue
+
+    // Sets the frame's instance count, growing its visible buffer to match and pointing its descriptor set at the
+    // frame's instance buffer when that was replaced. Only once the frame's fence has signalled.
+    void setInstances(uint32_t currentFrame, uint32_t count, bool instanceBufferChanged);
+
+    // Records the cull pass and the barrier the draw waits on. Must be outside a render pass.
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t currentFrame) const;
+
+    // Draw the visible instances of the frame with whatever vertex input is already bound
+    void drawIndirect(VkCommandBuffer commandBuffer, uint32_t currentFrame) const;
+    void drawPointsIndirect(VkCommandBuffer commandBuffer, uint32_t currentFrame) const;
+
+private:
+    PresentationManager* presentMan = PresentationManager::getInstance();
+    BufferManager* bufferMan = BufferManager::getInstance();
+
+    uint32_t indexCount = 0;
+    std::vector<uint32_t> instanceCounts;    // Per frame in flight
+    std::vector<uint32_t> visibleCapacities; // In instances
+
+    VkDescriptorSetLayout descriptorSetLayout{};
+    VkDescriptorPool descriptorPool{};
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    VkPipelineLayout pipelineLayout{};
+    VkPipeline pipeline{};
+
+    std::vector<VmaAllocation> visibleAllocations;
+    std::vector<VmaAllocation> drawAllocations;
+
+    void createDescriptorSetLayout();
+    void createPipeline();
+    void createDescriptorSets();
+    void createVisibleBuffer(uint32_t frame, uint32_t capacity);
+    void destroyVisibleBuffer(uint32_t frame);
+    void writeDescriptorSet(uint32_t frame);
+};
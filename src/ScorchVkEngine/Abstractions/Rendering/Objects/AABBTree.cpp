@@ -0,0 +1,415 @@
+#include "AABBTree.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <vector>
+
+namespace Physics
+{
+    namespace
+    {
+        // Node stack for tree walks. It lives on the call stack and only moves to the heap, doubling, once it is full
+        class NodeStack
+        {
+        public:
+            void push(const int32_t node)
+            {
+                if (count == capacity) grow();
+                stack[count++] = node;
+            }
+
+            int32_t pop() { return stack[--count]; }
+            bool empty() const { return count == 0; }
+
+        private:
+            std::array<int32_t, 256> fixedStack;
+            std::vector<int32_t> grownStack;
+            int32_t* stack = fixedStack.data();
+            uint32_t count = 0;
+            uint32_t capacity = static_cast<uint32_t>(fixedStack.size());
+
+            void grow()
+            {
+                capacity *= 2;
+                if (grownStack.empty()) grownStack.assign(fixedStack.begin(), fixedStack.end());
+                grownStack.resize(capacity);
+                stack = grownStack.data();
+            }
+        };
+    }
+
+    template<typename F>
+    void AABBTree::query(const AABB& box, F&& f) const
+    {
+        if (root == nullNode) return;
+
+        // Rotations keep the height logarithmic, so the fixed part of the stack is plenty, and the heap only backs it up
+        NodeStack stack;
+        stack.push(root);
+
+        while (!stack.empty())
+        {
+            const Node& node = nodes[stack.pop()];
+            if (!node.box.overlaps(box)) continue;
+
+            if (node.isLeaf()) f(node.body);
+            else
+            {
+                stack.push(node.child1);
+                stack.push(node.child2);
+            }
+        }
+    }
+
+    void AABBTree::build(const std::vector<RigidBody*>& bodies)
+    {
+        const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+
+        // Bodies past the end of the list are gone
+        for (uint32_t i = static_cast<uint32_t>(bodyLeaf.size()); i-- > bodyCount;)
+        {
+            removeLeaf(bodyLeaf[i]);
+            freeNode(bodyLeaf[i]);
+        }
+
+        bodyLeaf.resize(bodyCount, nullNode);
+        tightBoxes.resize(bodyCount);
+        reinsertCount = 0;
+
+        uint32_t movedCount = 0;
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            const glm::vec2 extent{bodies[i]->radius};
+            tightBoxes[i] = { bodies[i]->currPos - extent, bodies[i]->currPos + extent };
+
+            if (bodyLeaf[i] == nullNode || !nodes[bodyLeaf[i]].box.contains(tightBoxes[i])) movedCount++;
+        }
+
+        // Inserting a large part of the scene one body at a time gives a poor tree, so build it again top down instead
+        if (movedCount > bodyCount / 4)
+        {
+            buildTopDown();
+            return;
+        }
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            int32_t leaf = bodyLeaf[i];
+            if (leaf != nullNode && nodes[leaf].box.contains(tightBoxes[i])) continue;
+
+            if (leaf == nullNode)
+            {
+                leaf = allocateNode();
+                nodes[leaf].body = i;
+                bodyLeaf[i] = leaf;
+            }
+            else
+            {
+                removeLeaf(leaf);
+                reinsertCount++;
+            }
+
+            nodes[leaf].box = { tightBoxes[i].min - fatMargin, tightBoxes[i].max + fatMargin };
+            insertLeaf(leaf);
+        }
+    }
+
+    void AABBTree::buildTopDown()
+    {
+        const uint32_t bodyCount = static_cast<uint32_t>(tightBoxes.size());
+
+        nodes.clear();
+        nodes.reserve(2 * bodyCount - 1);
+        freeList = nullNode;
+
+        std::vector<uint32_t> order(bodyCount);
+        for (uint32_t i = 0; i < bodyCount; i++) order[i] = i;
+
+        root = buildSubtree(order.data(), order.data() + bodyCount, nullNode);
+        reinsertCount = bodyCount;
+    }
+
+    // Splits the bodies at the median of the longest axis of their centres. Nodes are allocated depth first, so a
+    // subtree sits together in memory.
+    int32_t AABBTree::buildSubtree(uint32_t* first, uint32_t* last, const int32_t parent)
+    {
+        const int32_t index = allocateNode();
+        nodes[index].parent = parent;
+
+        if (last - first == 1)
+        {
+            nodes[index].body = *first;
+            nodes[index].box = { tightBoxes[*first].min - fatMargin, tightBoxes[*first].max + fatMargin };
+            bodyLeaf[*first] = index;
+            return index;
+        }
+
+        glm::vec2 centreMin{FLT_MAX}, centreMax{-FLT_MAX};
+        for (const uint32_t* body = first; body != last; body++)
+        {
+            const glm::vec2 centre = tightBoxes[*body].min + tightBoxes[*body].max;
+            centreMin = glm::min(centreMin, centre);
+            centreMax = glm::max(centreMax, centre);
+        }
+
+        const int axis = centreMax.x - centreMin.x >= centreMax.y - centreMin.y ? 0 : 1;
+        uint32_t* middle = first + (last - first) / 2;
+
+        std::nth_element(first, middle, last, [&](const uint32_t a, const uint32_t b)
+        {
+            return tightBoxes[a].min[axis] + tightBoxes[a].max[axis] < tightBoxes[b].min[axis] + tightBoxes[b].max[axis];
+        });
+
+        const int32_t child1 = buildSubtree(first, middle, index);
+        const int32_t child2 = buildSubtree(middle, last, index);
+
+        Node& node = nodes[index];
+        node.child1 = child1;
+        node.child2 = child2;
+        node.height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        node.box = AABB::combine(nodes[child1].box, nodes[child2].box);
+
+        return index;
+    }
+
+    void AABBTree::findPairs(std::vector<BodyPair>& pairs) const
+    {
+        // Query the leaves in tree order rather than body order, so consecutive queries walk the same nodes
+        query(AABB{glm::vec2{-FLT_MAX}, glm::vec2{FLT_MAX}}, [&](const uint32_t a)
+        {
+            query(tightBoxes[a], [&](const uint32_t b)
+            {
+                if (b > a && tightBoxes[a].overlaps(tightBoxes[b])) pairs.push_back({a, b});
+            });
+        });
+    }
+
+    void AABBTree::findNeighbours(const uint32_t body, std::vector<uint32_t>& neighbours) const
+    {
+        query(tightBoxes[body], [&](const uint32_t other)
+        {
+            if (other != body && tightBoxes[body].overlaps(tightBoxes[other])) neighbours.push_back(other);
+        });
+    }
+
+    int32_t AABBTree::allocateNode()
+    {
+        if (freeList == nullNode)
+        {
+            nodes.emplace_back();
+            return static_cast<int32_t>(nodes.size() - 1);
+        }
+
+        const int32_t node = freeList;
+        freeList = nodes[node].parent;
+        nodes[node] = Node{};
+
+        return node;
+    }
+
+    void AABBTree::freeNode(const int32_t node)
+    {
+        nodes[node].parent = freeList;
+        nodes[node].height = -1;
+        freeList = node;
+    }
+
+    void AABBTree::insertLeaf(const int32_t leaf)
+    {
+        if (root == nullNode)
+        {
+            root = leaf;
+            nodes[root].parent = nullNode;
+            return;
+        }
+
+        // Find the best sibling by walking down the cheapest branch
+        const AABB leafBox = nodes[leaf].box;
+        int32_t index = root;
+
+        while (!nodes[index].isLeaf())
+        {
+            const Node& node = nodes[index];
+
+            const float area = node.box.perimeter();
+            const float combinedArea = AABB::combine(node.box, leafBox).perimeter();
+
+            // Cost of pairing the leaf with this node, and the cost pushed down onto either child
+            const float cost = 2.0f * combinedArea;
+            const float inheritanceCost = 2.0f * (combinedArea - area);
+
+            auto descendCost = [&](const int32_t child)
+            {
+                const float combined = AABB::combine(leafBox, nodes[child].box).perimeter();
+                return (nodes[child].isLeaf() ? combined : combined - nodes[child].box.perimeter()) + inheritanceCost;
+            };
+
+            const float cost1 = descendCost(node.child1);
+            const float cost2 = descendCost(node.child2);
+
+            if (cost < cost1 && cost < cost2) break;
+
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        const int32_t sibling = index;
+        const int32_t oldParent = nodes[sibling].parent;
+        const int32_t newParent = allocateNode();
+
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].box = AABB::combine(leafBox, nodes[sibling].box);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent == nullNode) root = newParent;
+        else if (nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+        else nodes[oldParent].child2 = newParent;
+
+        refit(nodes[leaf].parent);
+    }
+
+    void AABBTree::removeLeaf(const int32_t leaf)
+    {
+        if (leaf == root)
+        {
+            root = nullNode;
+            return;
+        }
+
+        const int32_t parent = nodes[leaf].parent;
+        const int32_t grandParent = nodes[parent].parent;
+        const int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+        freeNode(parent);
+
+        if (grandParent == nullNode)
+        {
+            root = sibling;
+            nodes[sibling].parent = nullNode;
+            return;
+        }
+
+        if (nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+        else nodes[grandParent].child2 = sibling;
+        nodes[sibling].parent = grandParent;
+
+        refit(grandParent);
+    }
+
+    void AABBTree::refit(int32_t index)
+    {
+        while (index != nullNode)
+        {
+            index = balance(index);
+
+            Node& node = nodes[index];
+            node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+            node.box = AABB::combine(nodes[node.child1].box, nodes[node.child2].box);
+
+            index = node.parent;
+        }
+    }
+
+    // Rotates the taller child up when the two subtrees of a node differ in height by more than one
+    int32_t AABBTree::balance(const int32_t iA)
+    {
+        Node& A = nodes[iA];
+        if (A.isLeaf() || A.height < 2) return iA;
+
+        const int32_t iB = A.child1;
+        const int32_t iC = A.child2;
+        Node& B = nodes[iB];
+        Node& C = nodes[iC];
+
+        const int32_t heightDifference = C.height - B.height;
+
+        auto replaceInParent = [&](const int32_t newChild)
+        {
+            const int32_t parent = nodes[newChild].parent;
+
+            if (parent == nullNode) root = newChild;
+            else if (nodes[parent].child1 == iA) nodes[parent].child1 = newChild;
+            else nodes[parent].child2 = newChild;
+        };
+
+        // Rotate C up
+        if (heightDifference > 1)
+        {
+            const int32_t iF = C.child1;
+            const int32_t iG = C.child2;
+            Node& F = nodes[iF];
+            Node& G = nodes[iG];
+
+            C.child1 = iA;
+            C.parent = A.parent;
+            A.parent = iC;
+            replaceInParent(iC);
+
+            if (F.height > G.height)
+            {
+                C.child2 = iF;
+                A.child2 = iG;
+                G.parent = iA;
+                A.box = AABB::combine(B.box, G.box);
+                C.box = AABB::combine(A.box, F.box);
+                A.height = 1 + std::max(B.height, G.height);
+                C.height = 1 + std::max(A.height, F.height);
+            }
+            else
+            {
+                C.child2 = iG;
+                A.child2 = iF;
+                F.parent = iA;
+                A.box = AABB::combine(B.box, F.box);
+                C.box = AABB::combine(A.box, G.box);
+                A.height = 1 + std::max(B.height, F.height);
+                C.height = 1 + std::max(A.height, G.height);
+            }
+
+            return iC;
+        }
+
+        // Rotate B up
+        if (heightDifference < -1)
+        {
+            const int32_t iD = B.child1;
+            const int32_t iE = B.child2;
+            Node& D = nodes[iD];
+            Node& E = nodes[iE];
+
+            B.child1 = iA;
+            B.parent = A.parent;
+            A.parent = iB;
+            replaceInParent(iB);
+
+            if (D.height > E.height)
+            {
+                B.child2 = iD;
+                A.child1 = iE;
+                E.parent = iA;
+                A.box = AABB::combine(C.box, E.box);
+                B.box = AABB::combine(A.box, D.box);
+                A.height = 1 + std::max(C.height, E.height);
+                B.height = 1 + std::max(A.height, D.height);
+            }
+            else
+            {
+                B.child2 = iE;
+                A.child1 = iD;
+                D.parent = iA;
+                A.box = AABB::combine(C.box, D.box);
+                B.box = AABB::combine(A.box, E.box);
+                A.height = 1 + std::max(C.height, D.height);
+                B.height = 1 + std::max(A.height, E.height);
+            }
+
+            return iB;
+        }
+
+        return iA;
+    }
+}
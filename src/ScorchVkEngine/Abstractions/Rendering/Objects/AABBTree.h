@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+
+namespace Physics
+{
+    struct AABB
+    {
+        glm::vec2 min, max;
+
+        float perimeter() const { return 2.0f * (max.x - min.x + max.y - min.y); }
+        bool contains(const AABB& other) const { return min.x <= other.min.x && min.y <= other.min.y && other.max.x <= max.x && other.max.y <= max.y; }
+        bool overlaps(const AABB& other) const { return min.x <= other.max.x && min.y <= other.max.y && other.min.x <= max.x && other.min.y <= max.y; }
+
+        static AABB combine(const AABB& a, const AABB& b) { return { glm::min(a.min, b.min), glm::max(a.max, b.max) }; }
+    };
+
+    // Incremental dynamic bounding volume tree. Leaves hold fattened boxes, so a body is only re-inserted once it leaves
+    // its fat box. Insertion walks down by the surface area heuristic (perimeter in 2D) and rotations keep the tree balanced.
+    // When a large part of the scene has moved, the tree is rebuilt top down instead, with nodes laid out depth first.
+    // It has no fixed extent and its memory follows the body count, which suits sparse scenes spread over large worlds.
+    class AABBTree : public Broadphase
+    {
+    public:
+        static constexpr float fatMargin = 0.05f;
+
+        void build(const std::vector<RigidBody*>& bodies) override;
+        void findPairs(std::vector<BodyPair>& pairs) const override;
+        void findNeighbours(uint32_t body, std::vector<uint32_t>& neighbours) const override;
+
+        uint32_t getHeight() const { return root == nullNode ? 0 : static_cast<uint32_t>(nodes[root].height); }
+        uint32_t getReinsertCount() const { return reinsertCount; }
+
+    private:
+        static constexpr int32_t nullNode = -1;
+
+        struct Node
+        {
+            AABB box;
+            int32_t parent = nullNode; // Next free node while on the free list
+            int32_t child1 = nullNode, child2 = nullNode;
+            int32_t height = 0;        // Zero for leaves
+            uint32_t body = 0;
+
+            bool isLeaf() const { return child1 == nullNode; }
+        };
+
+        std::vector<Node> nodes;
+        int32_t root = nullNode;
+        int32_t freeList = nullNode;
+
+        std::vector<int32_t> bodyLeaf;
+        std::vector<AABB> tightBoxes; // As of the last build
+        uint32_t reinsertCount = 0;
+
+        void buildTopDown();
+        int32_t buildSubtree(uint32_t* first, uint32_t* last, int32_t parent);
+
+        int32_t allocateNode();
+        void freeNode(int32_t node);
+
+        void insertLeaf(int32_t leaf);
+        void removeLeaf(int32_t leaf);
+        int32_t balance(int32_t node);
+        void refit(int32_t node);
+
+        // Calls f(body) for every leaf whose fat box overlaps box
+        template<typename F>
+        void query(const AABB& box, F&& f) const;
+    };
+}
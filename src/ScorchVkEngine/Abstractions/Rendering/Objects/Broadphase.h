@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <Abstractions/Rendering/Objects/RigidBody.h>
+
+namespace Physics
+{
+    struct BodyPair
+    {
+        uint32_t a, b;
+    };
+
+    // Finds the bodies that are close enough to touch. Bodies are referred to by their index in the vector passed to build.
+    class Broadphase
+    {
+    public:
+        virtual ~Broadphase() = default;
+
+        virtual void build(const std::vector<RigidBody*>& bodies) = 0;
+
+        // Every candidate pair exactly once
+        virtual void findPairs(std::vector<BodyPair>& pairs) const = 0;
+
+        // Every candidate touching body, appended to neighbours
+        virtual void findNeighbours(uint32_t body, std::vector<uint32_t>& neighbours) const = 0;
+
+        // Counts every cell holding n bodies into histogram[n], and fuller ones into the last bucket. Broadphases without
+        // cells leave it alone.
+        virtual void addOccupancy(std::vector<uint32_t>& /*histogram*/) const {}
+
+    protected:
+        static void addCell(std::vector<uint32_t>& histogram, const size_t bodyCount)
+        {
+            histogram[std::min(bodyCount, histogram.size() - 1)]++;
+        }
+    };
+}
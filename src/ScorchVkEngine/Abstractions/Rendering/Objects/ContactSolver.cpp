@@ -0,0 +1,233 @@
+#include "ContactSolver.h"
+
+#include <algorithm>
+#include <bit>
+
+#include <Abstractions/Rendering/Objects/PhysicsHeader.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCORCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Physics
+{
+    constexpr uint32_t chunkSize = 1024; // Pairs or bodies handed to a single thread at once
+
+    void ContactSolver::solve(std::vector<RigidBody*>& bodies, const Broadphase& broadphase)
+    {
+        if (mode == SolverMode::Jacobi)
+        {
+            solveJacobi(bodies, broadphase);
+            return;
+        }
+
+        pairs.clear();
+        broadphase.findPairs(pairs);
+
+        if (mode == SolverMode::Serial)
+        {
+            solveSerial(bodies, pairs, 0, static_cast<uint32_t>(pairs.size()));
+            return;
+        }
+
+        colourPairs(static_cast<uint32_t>(bodies.size()));
+
+        // A correction only reaches the bodies of later colours within a sweep, while the serial sweep carries it
+        // along the whole broadphase order. One sweep leaves about twice the serial overlap in a settled pile, a second
+        // sweep over the same colouring brings it back to about the serial overlap
+        for (uint32_t sweep = 0; sweep < colouredSweeps; sweep++)
+        {
+            recordStats = sweep == 0;
+
+            // Colours are still solved one after the other, so every pair sees the corrections of the colours before it
+            for (uint32_t colour = 0; colour < colourCount; colour++)
+            {
+                const uint32_t first = batchStart[colour];
+
+                jobSystem->parallelFor(batchStart[colour + 1] - first, chunkSize, [&](const uint32_t chunkFirst, const uint32_t chunkLast)
+                {
+                    solveBatch(bodies, first + chunkFirst, first + chunkLast);
+                });
+            }
+
+            // Pairs that ran out of colours may share bodies, so they are solved in order
+            solveSerial(bodies, batchedPairs, batchStart[maxColours], batchStart[maxColours + 1]);
+        }
+
+        recordStats = true;
+    }
+
+    void ContactSolver::solveJacobi(std::vector<RigidBody*>& bodies, const Broadphase& broadphase)
+    {
+        pairs.clear();
+        colourCount = 0;
+
+        const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+        deltas.resize(bodyCount);
+
+        // Accumulate: every body reads its neighbours and only writes its own delta
+        jobSystem->parallelFor(bodyCount, chunkSize, [&](const uint32_t first, const uint32_t last)
+        {
+            std::vector<uint32_t>& neighbours = neighbourScratch;
+
+            // Every pair is visited from both of its bodies, the statistics only count it from the lower index
+            SCORCH_STAT(uint64_t candidatePairs = 0; uint64_t overlaps = 0; float maxPenetration = 0.0f;)
+
+            for (uint32_t i = first; i < last; i++)
+            {
+                const RigidBody* body = bodies[i];
+                glm::vec2 delta{};
+
+                neighbours.clear();
+                broadphase.findNeighbours(i, neighbours);
+
+                for (const uint32_t j : neighbours)
+                {
+                    SCORCH_STAT(candidatePairs += i < j;)
+
+                    const RigidBody* other = bodies[j];
+                    const glm::vec2 collisionAxis = body->currPos - other->currPos;
+                    const float squareDistance = collisionAxis.x * collisionAxis.x + collisionAxis.y * collisionAxis.y;
+
+                    const float minDistance = body->radius + other->radius;
+                    const float totalInvMass = body->invMass + other->invMass;
+
+                    if (squareDistance < minDistance * minDistance && squareDistance > 0.0f && totalInvMass > 0.0f)
+                    {
+                        const float distance = sqrt(squareDistance);
+                        delta += body->invMass / totalInvMass * (minDistance - distance) / distance * collisionAxis;
+
+                        SCORCH_STAT(if (i < j) { overlaps++; maxPenetration = std::max(maxPenetration, minDistance - distance); })
+                    }
+                }
+
+                deltas[i] = delta;
+            }
+
+            SCORCH_STAT(PhysicsStats::getInstance()->add(candidatePairs, overlaps, maxPenetration);)
+        });
+
+        // Apply
+        jobSystem->parallelFor(bodyCount, chunkSize, [&](const uint32_t first, const uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++) bodies[i]->currPos += relaxation * deltas[i];
+        });
+    }
+
+    void ContactSolver::colourPairs(const uint32_t bodyCount)
+    {
+        bodyColours.assign(bodyCount, 0);
+        pairColours.resize(pairs.size());
+        batchStart.assign(maxColours + 2, 0);
+        colourCount = 0;
+
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            const uint64_t usedColours = bodyColours[pairs[i].a] | bodyColours[pairs[i].b];
+
+            // The lowest colour neither body is in yet, or the overflow batch when all of them are taken
+            uint32_t colour = maxColours;
+            if (usedColours != ~0ull)
+            {
+                colour = static_cast<uint32_t>(std::countr_one(usedColours));
+                bodyColours[pairs[i].a] |= 1ull << colour;
+                bodyColours[pairs[i].b] |= 1ull << colour;
+                colourCount = std::max(colourCount, colour + 1);
+            }
+
+            pairColours[i] = static_cast<uint8_t>(colour);
+            batchStart[colour + 1]++;
+        }
+
+        for (uint32_t c = 0; c <= maxColours; c++) batchStart[c + 1] += batchStart[c];
+
+        batchCursor.assign(batchStart.begin(), batchStart.end() - 1);
+        batchedPairs.resize(pairs.size());
+        for (size_t i = 0; i < pairs.size(); i++) batchedPairs[batchCursor[pairColours[i]]++] = pairs[i];
+    }
+
+    void ContactSolver::solveBatch(std::vector<RigidBody*>& bodies, const uint32_t first, const uint32_t last)
+    {
+        uint32_t p = first;
+
+#ifdef SCORCH_SSE2
+        SCORCH_STAT(uint64_t overlaps = 0; float maxPenetration = 0.0f;)
+
+        // Four pairs at a time. Every body appears once per colour, so the lanes never read a body another lane writes
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; p + 4 <= last; p += 4)
+        {
+            RigidBody* body1[4];
+            RigidBody* body2[4];
+            alignas(16) float x1[4], y1[4], x2[4], y2[4], radii[4], invMass1[4], invMass2[4];
+
+            for (int k = 0; k < 4; k++)
+            {
+                body1[k] = bodies[batchedPairs[p + k].a];
+                body2[k] = bodies[batchedPairs[p + k].b];
+                x1[k] = body1[k]->currPos.x; y1[k] = body1[k]->currPos.y;
+                x2[k] = body2[k]->currPos.x; y2[k] = body2[k]->currPos.y;
+                radii[k] = body1[k]->radius + body2[k]->radius;
+                invMass1[k] = body1[k]->invMass; invMass2[k] = body2[k]->invMass;
+            }
+
+            const __m128 axisX = _mm_sub_ps(_mm_load_ps(x1), _mm_load_ps(x2));
+            const __m128 axisY = _mm_sub_ps(_mm_load_ps(y1), _mm_load_ps(y2));
+            const __m128 squareDistance = _mm_add_ps(_mm_mul_ps(axisX, axisX), _mm_mul_ps(axisY, axisY));
+
+            const __m128 minDistance = _mm_load_ps(radii);
+            const __m128 weight1 = _mm_load_ps(invMass1);
+            const __m128 weight2 = _mm_load_ps(invMass2);
+            const __m128 totalInvMass = _mm_add_ps(weight1, weight2);
+
+            const __m128 overlapping = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(squareDistance, _mm_mul_ps(minDistance, minDistance)), _mm_cmpgt_ps(squareDistance, zero)), _mm_cmpgt_ps(totalInvMass, zero));
+            if (_mm_movemask_ps(overlapping) == 0) continue;
+
+            // delta * n / totalInvMass, with n = axis / distance, masked to zero for the pairs that do not overlap
+            const __m128 distance = _mm_sqrt_ps(squareDistance);
+
+#ifdef SCORCH_STATS
+            alignas(16) float penetrations[4];
+            _mm_store_ps(penetrations, _mm_and_ps(overlapping, _mm_sub_ps(minDistance, distance)));
+            overlaps += std::popcount(static_cast<uint32_t>(_mm_movemask_ps(overlapping)));
+            for (const float penetration : penetrations) maxPenetration = std::max(maxPenetration, penetration);
+#endif
+
+            const __m128 scale = _mm_and_ps(overlapping, _mm_div_ps(_mm_sub_ps(minDistance, distance), _mm_mul_ps(distance, totalInvMass)));
+            const __m128 scale1 = _mm_mul_ps(scale, weight1);
+            const __m128 scale2 = _mm_mul_ps(scale, weight2);
+
+            alignas(16) float correction1X[4], correction1Y[4], correction2X[4], correction2Y[4];
+            _mm_store_ps(correction1X, _mm_mul_ps(axisX, scale1));
+            _mm_store_ps(correction1Y, _mm_mul_ps(axisY, scale1));
+            _mm_store_ps(correction2X, _mm_mul_ps(axisX, scale2));
+            _mm_store_ps(correction2Y, _mm_mul_ps(axisY, scale2));
+
+            for (int k = 0; k < 4; k++)
+            {
+                body1[k]->currPos += glm::vec2(correction1X[k], correction1Y[k]);
+                body2[k]->currPos -= glm::vec2(correction2X[k], correction2Y[k]);
+            }
+        }
+
+        SCORCH_STAT(if (recordStats) PhysicsStats::getInstance()->add(p - first, overlaps, maxPenetration);)
+#endif
+
+        solveSerial(bodies, batchedPairs, p, last);
+    }
+
+    void ContactSolver::solveSerial(std::vector<RigidBody*>& bodies, const std::vector<BodyPair>& pairList, const uint32_t first, const uint32_t last)
+    {
+        SCORCH_STAT(uint64_t overlaps = 0; float maxPenetration = 0.0f;)
+
+        for (uint32_t p = first; p < last; p++)
+        {
+            [[maybe_unused]] const float penetration = SolveCollisions(bodies[pairList[p].a], bodies[pairList[p].b]);
+            SCORCH_STAT(overlaps += penetration > 0.0f; maxPenetration = std::max(maxPenetration, penetration);)
+        }
+
+        SCORCH_STAT(if (recordStats) PhysicsStats::getInstance()->add(last - first, overlaps, maxPenetration);)
+    }
+}
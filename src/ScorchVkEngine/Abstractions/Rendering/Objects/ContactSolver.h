@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/RigidBody.h>
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+#include <Abstractions/JobSystem.h>
+
+namespace Physics
+{
+    enum class SolverMode : int
+    {
+        Serial,   // Gauss-Seidel in broadphase order, positions are written as soon as a pair is solved
+        Coloured, // Gauss-Seidel over colour batches, each batch is solved in parallel
+        Jacobi,   // Every body gathers its corrections into a delta buffer, which is applied in a second pass
+    };
+
+    // Collects candidate pairs from the broadphase and resolves the overlapping ones.
+    // In coloured mode the pairs are greedily coloured so that no body appears twice in a colour, which lets every
+    // pair of a colour be solved at the same time without two threads writing the same body.
+    // In Jacobi mode no pair list is built at all, every body only writes its own delta, so both passes are plain
+    // parallel loops over the bodies and map one to one onto a compute shader.
+    class ContactSolver
+    {
+    public:
+        static constexpr uint32_t maxColours = 64; // One bit per colour in the per-body masks
+
+        SolverMode mode = SolverMode::Coloured;
+        float relaxation = 1.0f; // Scales the accumulated delta in Jacobi mode, lower values damp jitter in dense piles
+        uint32_t colouredSweeps = 2; // Passes over the colour batches per solve in coloured mode
+
+        void solve(std::vector<RigidBody*>& bodies, const Broadphase& broadphase);
+
+        uint32_t getPairCount() const { return static_cast<uint32_t>(pairs.size()); }
+        uint32_t getColourCount() const { return colourCount; }
+
+    private:
+        JobSystem* jobSystem = JobSystem::getInstance();
+
+        std::vector<BodyPair> pairs;
+        std::vector<uint8_t> pairColours;
+        std::vector<uint64_t> bodyColours;
+
+        std::vector<BodyPair> batchedPairs;     // Pairs sorted by colour, the overflow batch comes last
+        std::vector<uint32_t> batchStart;       // maxColours + 1 batches, plus one past the end
+        std::vector<uint32_t> batchCursor;
+        uint32_t colourCount = 0;
+
+        std::vector<glm::vec2> deltas;
+        inline static thread_local std::vector<uint32_t> neighbourScratch; // Kept per worker so its capacity survives between solves
+
+        bool recordStats = true; // Off for the sweeps after the first, which see the same pairs again
+
+        void colourPairs(uint32_t bodyCount);
+        void solveBatch(std::vector<RigidBody*>& bodies, uint32_t first, uint32_t last);
+        void solveSerial(std::vector<RigidBody*>& bodies, const std::vector<BodyPair>& pairList, uint32_t first, uint32_t last);
+        void solveJacobi(std::vector<RigidBody*>& bodies, const Broadphase& broadphase);
+    };
+}
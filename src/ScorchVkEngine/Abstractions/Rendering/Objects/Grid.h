@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+
+namespace Physics
+{
+    // Uniform grid centred on the origin. Rebuilt with a counting sort, so the bodies of a cell sit next to each other in cellBodies.
+    // Cells are kept at least as wide as the largest body, so the 3x3 neighbourhood of a body holds all of its contacts.
+    struct Grid : Broadphase
+    {
+        uint32_t width, height;
+        float cellSize;
+        glm::vec2 extent;
+        glm::vec2 origin;
+
+        std::vector<uint32_t> cellStart;  // Offset of every cell into cellBodies, plus one past the end
+        std::vector<uint32_t> cellBodies; // Body indices grouped by cell
+        std::vector<uint32_t> bodyCell;   // Cell of every body as of the last build
+
+        Grid(uint32_t w, uint32_t h, float size)
+        : width(w), height(h), cellSize(size), extent(size * glm::vec2(w, h)), origin(-0.5f * extent), cellStart(w * h + 1), cellCursor(w * h)
+        {}
+
+        // Keeps the covered extent and changes how finely it is divided
+        void setCellSize(const float size)
+        {
+            if (size == cellSize) return;
+
+            cellSize = size;
+            width = std::max(1u, static_cast<uint32_t>(ceil(extent.x / size)));
+            height = std::max(1u, static_cast<uint32_t>(ceil(extent.y / size)));
+            origin = -0.5f * size * glm::vec2(width, height);
+
+            cellStart.resize(width * height + 1);
+            cellCursor.resize(width * height);
+        }
+
+        // Bodies outside the grid are clamped into the border cells rather than indexing out of range
+        uint32_t cellIndex(const glm::vec2 pos) const
+        {
+            const glm::vec2 local = (pos - origin) / cellSize;
+            const int x = std::clamp(static_cast<int>(floor(local.x)), 0, static_cast<int>(width) - 1);
+            const int y = std::clamp(static_cast<int>(floor(local.y)), 0, static_cast<int>(height) - 1);
+
+            return static_cast<uint32_t>(y) * width + static_cast<uint32_t>(x);
+        }
+
+        void build(const std::vector<RigidBody*>& bodies) override
+        {
+            const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+
+            float maxDiameter = 0.0f;
+            for (const RigidBody* body : bodies) maxDiameter = std::max(maxDiameter, 2.0f * body->radius);
+            if (maxDiameter > 0.0f) setCellSize(maxDiameter);
+
+            bodyCell.resize(bodyCount);
+            cellBodies.resize(bodyCount);
+            std::fill(cellStart.begin(), cellStart.end(), 0);
+
+            for (uint32_t i = 0; i < bodyCount; i++)
+            {
+                bodyCell[i] = cellIndex(bodies[i]->currPos);
+                cellStart[bodyCell[i] + 1]++;
+            }
+
+            for (uint32_t c = 0; c < width * height; c++) cellStart[c + 1] += cellStart[c];
+
+            std::copy(cellStart.begin(), cellStart.end() - 1, cellCursor.begin());
+            for (uint32_t i = 0; i < bodyCount; i++) cellBodies[cellCursor[bodyCell[i]]++] = i;
+        }
+
+        // Calls f(a, b) exactly once for every pair of bodies sharing a cell or sitting in adjacent cells
+        template<typename F>
+        void forEachPair(F&& f) const
+        {
+            // Half of the 3x3 stencil, the other half is covered when the neighbouring cell takes its turn
+            constexpr int offsets[4][2] = { {1, 0}, {-1, 1}, {0, 1}, {1, 1} };
+
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    const uint32_t cell = y * width + x;
+
+                    for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+                    {
+                        for (uint32_t j = i + 1; j < cellStart[cell + 1]; j++) f(cellBodies[i], cellBodies[j]);
+
+                        for (const auto& offset : offsets)
+                        {
+                            const int nx = static_cast<int>(x) + offset[0];
+                            const int ny = static_cast<int>(y) + offset[1];
+                            if (nx < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height)) continue;
+
+                            const uint32_t other = static_cast<uint32_t>(ny) * width + static_cast<uint32_t>(nx);
+                            for (uint32_t j = cellStart[other]; j < cellStart[other + 1]; j++) f(cellBodies[i], cellBodies[j]);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Calls f(other) for every body in the 3x3 cells around body, apart from body itself
+        template<typename F>
+        void forEachNeighbour(const uint32_t body, F&& f) const
+        {
+            const int x = static_cast<int>(bodyCell[body] % width);
+            const int y = static_cast<int>(bodyCell[body] / width);
+
+            for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, static_cast<int>(height) - 1); ny++)
+            {
+                for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, static_cast<int>(width) - 1); nx++)
+                {
+                    const uint32_t cell = static_cast<uint32_t>(ny) * width + static_cast<uint32_t>(nx);
+                    for (uint32_t j = cellStart[cell]; j < cellStart[cell + 1]; j++)
+                        if (cellBodies[j] != body) f(cellBodies[j]);
+                }
+            }
+        }
+
+        void findPairs(std::vector<BodyPair>& pairs) const override
+        {
+            forEachPair([&pairs](const uint32_t a, const uint32_t b) { pairs.push_back({a, b}); });
+        }
+
+        void findNeighbours(const uint32_t body, std::vector<uint32_t>& neighbours) const override
+        {
+            forEachNeighbour(body, [&neighbours](const uint32_t other) { neighbours.push_back(other); });
+        }
+
+        void addOccupancy(std::vector<uint32_t>& histogram) const override
+        {
+            for (uint32_t c = 0; c < width * height; c++) addCell(histogram, cellStart[c + 1] - cellStart[c]);
+        }
+
+    private:
+        std::vector<uint32_t> cellCursor;
+    };
+}
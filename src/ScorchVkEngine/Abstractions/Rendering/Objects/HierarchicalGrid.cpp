@@ -0,0 +1,165 @@
+#include "HierarchicalGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Physics
+{
+    constexpr float maxCellsPerLevel = 1 << 20; // Bounds the finest level when the smallest bodies are tiny
+
+    template<typename F>
+    void HierarchicalGrid::forEachInBox(const Level& level, const glm::vec2 position, const float halfSize, F&& f) const
+    {
+        const uint32_t first = cellIndex(level, position - halfSize);
+        const uint32_t last = cellIndex(level, position + halfSize);
+
+        for (uint32_t y = first / level.width; y <= last / level.width; y++)
+        {
+            for (uint32_t x = first % level.width; x <= last % level.width; x++)
+            {
+                const uint32_t cell = y * level.width + x;
+                for (uint32_t j = level.cellStart[cell]; j < level.cellStart[cell + 1]; j++) f(level.cellBodies[j]);
+            }
+        }
+    }
+
+    void HierarchicalGrid::build(const std::vector<RigidBody*>& bodies)
+    {
+        const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+
+        positions.resize(bodyCount);
+        radii.resize(bodyCount);
+        bodyLevel.resize(bodyCount);
+        bodyCell.resize(bodyCount);
+
+        float minDiameter = std::numeric_limits<float>::max();
+        float maxDiameter = 0.0f;
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            positions[i] = bodies[i]->currPos;
+            radii[i] = bodies[i]->radius;
+            minDiameter = std::min(minDiameter, 2.0f * radii[i]);
+            maxDiameter = std::max(maxDiameter, 2.0f * radii[i]);
+        }
+
+        occupiedLevels = 0;
+        if (bodyCount == 0) { levelCount = 0; return; }
+
+        baseCellSize = std::max(minDiameter, std::sqrt(extent.x * extent.y / maxCellsPerLevel));
+        levelCount = levelOf(maxDiameter) + 1;
+
+        for (uint32_t l = 0; l < levelCount; l++)
+        {
+            resizeLevel(levels[l], baseCellSize * static_cast<float>(1u << l));
+            std::fill(levels[l].cellStart.begin(), levels[l].cellStart.end(), 0);
+        }
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            const uint32_t l = levelOf(2.0f * radii[i]);
+            bodyLevel[i] = static_cast<uint8_t>(l);
+            bodyCell[i] = cellIndex(levels[l], positions[i]);
+
+            levels[l].cellStart[bodyCell[i] + 1]++;
+            occupiedLevels |= 1u << l;
+        }
+
+        // Counting sort per level, same as the uniform grid
+        for (uint32_t l = 0; l < levelCount; l++)
+        {
+            Level& level = levels[l];
+
+            for (uint32_t c = 0; c < level.width * level.height; c++) level.cellStart[c + 1] += level.cellStart[c];
+
+            level.cellBodies.resize(level.cellStart.back());
+            std::copy(level.cellStart.begin(), level.cellStart.end() - 1, level.cellCursor.begin());
+        }
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            Level& level = levels[bodyLevel[i]];
+            level.cellBodies[level.cellCursor[bodyCell[i]]++] = i;
+        }
+    }
+
+    void HierarchicalGrid::findPairs(std::vector<BodyPair>& pairs) const
+    {
+        for (uint32_t ownLevel = 0; ownLevel < levelCount; ownLevel++)
+        {
+            // Walking the bodies in cell order keeps consecutive queries on neighbouring cells
+            for (const uint32_t a : levels[ownLevel].cellBodies)
+            {
+                // Pairs with a finer body are found by that body, so only this level and the coarser ones are walked
+                for (uint32_t l = ownLevel; l < levelCount; l++)
+                {
+                    if (!(occupiedLevels & (1u << l))) continue;
+
+                    const Level& level = levels[l];
+                    forEachInBox(level, positions[a], radii[a] + 0.5f * level.cellSize, [&](const uint32_t b)
+                    {
+                        if (l == ownLevel && b <= a) return;
+                        pairs.push_back({a, b});
+                    });
+                }
+            }
+        }
+    }
+
+    void HierarchicalGrid::findNeighbours(const uint32_t body, std::vector<uint32_t>& neighbours) const
+    {
+        for (uint32_t l = 0; l < levelCount; l++)
+        {
+            if (!(occupiedLevels & (1u << l))) continue;
+
+            const Level& level = levels[l];
+            forEachInBox(level, positions[body], radii[body] + 0.5f * level.cellSize, [&](const uint32_t other)
+            {
+                if (other != body) neighbours.push_back(other);
+            });
+        }
+    }
+
+    void HierarchicalGrid::resizeLevel(Level& level, const float cellSize)
+    {
+        if (level.cellSize == cellSize) return;
+
+        level.cellSize = cellSize;
+        level.width = std::max(1u, static_cast<uint32_t>(ceil(extent.x / cellSize)));
+        level.height = std::max(1u, static_cast<uint32_t>(ceil(extent.y / cellSize)));
+        level.origin = -0.5f * cellSize * glm::vec2(level.width, level.height);
+
+        level.cellStart.resize(level.width * level.height + 1);
+        level.cellCursor.resize(level.width * level.height);
+    }
+
+    uint32_t HierarchicalGrid::levelOf(const float diameter) const
+    {
+        // The finest level whose cells are at least as wide as the body
+        const float ratio = diameter / baseCellSize;
+        if (ratio <= 1.0f) return 0;
+
+        return std::min(static_cast<uint32_t>(ceil(log2(ratio))), maxLevels - 1);
+    }
+
+    uint32_t HierarchicalGrid::cellIndex(const Level& level, const glm::vec2 pos)
+    {
+        const glm::vec2 local = (pos - level.origin) / level.cellSize;
+        const int x = std::clamp(static_cast<int>(floor(local.x)), 0, static_cast<int>(level.width) - 1);
+        const int y = std::clamp(static_cast<int>(floor(local.y)), 0, static_cast<int>(level.height) - 1);
+
+        return static_cast<uint32_t>(y) * level.width + static_cast<uint32_t>(x);
+    }
+
+    void HierarchicalGrid::addOccupancy(std::vector<uint32_t>& histogram) const
+    {
+        for (uint32_t l = 0; l < levelCount; l++)
+        {
+            if (!(occupiedLevels & (1u << l))) continue;
+
+            const Level& level = levels[l];
+            for (uint32_t c = 0; c < level.width * level.height; c++) addCell(histogram, level.cellStart[c + 1] - level.cellStart[c]);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+
+namespace Physics
+{
+    // A stack of uniform grids whose cell sizes double from one level to the next. Every body is stored in the finest
+    // level whose cells are at least as wide as it is, so small bodies are never binned with the cell size of the largest.
+    // A body only looks for pairs in its own level and the coarser ones, and only in levels that hold any bodies.
+    class HierarchicalGrid : public Broadphase
+    {
+    public:
+        static constexpr uint32_t maxLevels = 16;
+
+        explicit HierarchicalGrid(glm::vec2 worldExtent) : extent(worldExtent) {}
+
+        void build(const std::vector<RigidBody*>& bodies) override;
+        void findPairs(std::vector<BodyPair>& pairs) const override;
+        void findNeighbours(uint32_t body, std::vector<uint32_t>& neighbours) const override;
+        void addOccupancy(std::vector<uint32_t>& histogram) const override; // Levels without bodies are left out
+
+        uint32_t getLevelCount() const { return levelCount; }
+        uint32_t getLevelBodyCount(const uint32_t level) const { return static_cast<uint32_t>(levels[level].cellBodies.size()); }
+
+    private:
+        struct Level
+        {
+            uint32_t width = 0, height = 0;
+            float cellSize = 0.0f;
+            glm::vec2 origin{};
+
+            std::vector<uint32_t> cellStart;
+            std::vector<uint32_t> cellBodies;
+            std::vector<uint32_t> cellCursor;
+        };
+
+        glm::vec2 extent;
+        float baseCellSize = 0.0f;
+        uint32_t levelCount = 0;
+        uint32_t occupiedLevels = 0; // One bit per level
+
+        Level levels[maxLevels];
+
+        // Copied at build time, like the cells themselves
+        std::vector<glm::vec2> positions;
+        std::vector<float> radii;
+        std::vector<uint8_t> bodyLevel;
+        std::vector<uint32_t> bodyCell;
+
+        uint32_t levelOf(float diameter) const;
+        static uint32_t cellIndex(const Level& level, glm::vec2 pos);
+
+        void resizeLevel(Level& level, float cellSize);
+
+        // Calls f(other) for every body of the level whose cell overlaps the box around position
+        template<typename F>
+        void forEachInBox(const Level& level, glm::vec2 position, float halfSize, F&& f) const;
+    };
+}
@@ -0,0 +1,143 @@
+#include "IncrementalGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Physics
+{
+    IncrementalGrid::IncrementalGrid(const uint32_t w, const uint32_t h, const float size)
+    : width(w), height(h), cellSize(size), extent(size * glm::vec2(w, h)), origin(-0.5f * extent), cells(w * h)
+    {}
+
+    void IncrementalGrid::setCellSize(const float size)
+    {
+        cellSize = size;
+        width = std::max(1u, static_cast<uint32_t>(std::ceil(extent.x / size)));
+        height = std::max(1u, static_cast<uint32_t>(std::ceil(extent.y / size)));
+        origin = -0.5f * size * glm::vec2(width, height);
+
+        for (std::vector<uint32_t>& cell : cells) cell.clear();
+        cells.resize(width * height);
+
+        std::fill(bodyCell.begin(), bodyCell.end(), noCell);
+    }
+
+    uint32_t IncrementalGrid::cellIndex(const glm::vec2 pos) const
+    {
+        const glm::vec2 local = (pos - origin) / cellSize;
+        const int x = std::clamp(static_cast<int>(std::floor(local.x)), 0, static_cast<int>(width) - 1);
+        const int y = std::clamp(static_cast<int>(std::floor(local.y)), 0, static_cast<int>(height) - 1);
+
+        return static_cast<uint32_t>(y) * width + static_cast<uint32_t>(x);
+    }
+
+    void IncrementalGrid::insert(const uint32_t body, const uint32_t cell)
+    {
+        bodyCell[body] = cell;
+        bodySlot[body] = static_cast<uint32_t>(cells[cell].size());
+        cells[cell].push_back(body);
+    }
+
+    // Swaps the last body of the cell into the freed slot
+    void IncrementalGrid::remove(const uint32_t body)
+    {
+        std::vector<uint32_t>& cell = cells[bodyCell[body]];
+
+        const uint32_t last = cell.back();
+        cell[bodySlot[body]] = last;
+        bodySlot[last] = bodySlot[body];
+        cell.pop_back();
+
+        bodyCell[body] = noCell;
+    }
+
+    void IncrementalGrid::build(const std::vector<RigidBody*>& bodies)
+    {
+        const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+
+        // Bodies past the end of the list are gone
+        for (uint32_t i = static_cast<uint32_t>(bodyCell.size()); i-- > bodyCount;)
+            if (bodyCell[i] != noCell) remove(i);
+
+        bodyCell.resize(bodyCount, noCell);
+        bodySlot.resize(bodyCount);
+
+        float maxDiameter = 0.0f;
+        for (const RigidBody* body : bodies) maxDiameter = std::max(maxDiameter, 2.0f * body->radius);
+        if (maxDiameter > 0.0f && (maxDiameter > cellSize || maxDiameter < 0.25f * cellSize)) setCellSize(maxDiameter);
+
+        newCell.resize(bodyCount);
+        movedCount = 0;
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            newCell[i] = cellIndex(bodies[i]->currPos);
+            if (newCell[i] != bodyCell[i]) movedCount++;
+        }
+
+        // Moving bodies one by one costs more per body than refiling them in order, so past a point start over
+        if (movedCount > bodyCount / 4)
+        {
+            for (std::vector<uint32_t>& cell : cells) cell.clear();
+            for (uint32_t i = 0; i < bodyCount; i++) insert(i, newCell[i]);
+            return;
+        }
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            if (newCell[i] == bodyCell[i]) continue;
+
+            if (bodyCell[i] != noCell) remove(i);
+            insert(i, newCell[i]);
+        }
+    }
+
+    void IncrementalGrid::findPairs(std::vector<BodyPair>& pairs) const
+    {
+        // Half of the 3x3 stencil, the other half is covered when the neighbouring cell takes its turn
+        constexpr int offsets[4][2] = { {1, 0}, {-1, 1}, {0, 1}, {1, 1} };
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const std::vector<uint32_t>& cell = cells[y * width + x];
+                if (cell.empty()) continue;
+
+                for (uint32_t i = 0; i < static_cast<uint32_t>(cell.size()); i++)
+                    for (uint32_t j = i + 1; j < static_cast<uint32_t>(cell.size()); j++) pairs.push_back({cell[i], cell[j]});
+
+                for (const auto& offset : offsets)
+                {
+                    const int nx = static_cast<int>(x) + offset[0];
+                    const int ny = static_cast<int>(y) + offset[1];
+                    if (nx < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height)) continue;
+
+                    const std::vector<uint32_t>& other = cells[static_cast<uint32_t>(ny) * width + static_cast<uint32_t>(nx)];
+                    for (const uint32_t a : cell)
+                        for (const uint32_t b : other) pairs.push_back({a, b});
+                }
+            }
+        }
+    }
+
+    void IncrementalGrid::findNeighbours(const uint32_t body, std::vector<uint32_t>& neighbours) const
+    {
+        const int x = static_cast<int>(bodyCell[body] % width);
+        const int y = static_cast<int>(bodyCell[body] / width);
+
+        for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, static_cast<int>(height) - 1); ny++)
+        {
+            for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, static_cast<int>(width) - 1); nx++)
+            {
+                for (const uint32_t other : cells[static_cast<uint32_t>(ny) * width + static_cast<uint32_t>(nx)])
+                    if (other != body) neighbours.push_back(other);
+            }
+        }
+    }
+
+    void IncrementalGrid::addOccupancy(std::vector<uint32_t>& histogram) const
+    {
+        for (const std::vector<uint32_t>& cell : cells) addCell(histogram, cell.size());
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+
+namespace Physics
+{
+    // Uniform grid that keeps its cells between builds. Every body remembers the cell it is filed under, and a build only
+    // moves the bodies that crossed into another cell since the last one, so its cost follows how much the scene moves.
+    // The cells are only refiled from scratch when the largest body no longer fits in a cell, or fits in a quarter of one.
+    class IncrementalGrid : public Broadphase
+    {
+    public:
+        IncrementalGrid(uint32_t w, uint32_t h, float size);
+
+        void build(const std::vector<RigidBody*>& bodies) override;
+        void findPairs(std::vector<BodyPair>& pairs) const override;
+        void findNeighbours(uint32_t body, std::vector<uint32_t>& neighbours) const override;
+        void addOccupancy(std::vector<uint32_t>& histogram) const override;
+
+        uint32_t getMovedCount() const { return movedCount; }
+
+    private:
+        static constexpr uint32_t noCell = UINT32_MAX;
+
+        uint32_t width, height;
+        float cellSize;
+        glm::vec2 extent;
+        glm::vec2 origin;
+
+        std::vector<std::vector<uint32_t>> cells;
+        std::vector<uint32_t> bodyCell; // Cell every body is filed under
+        std::vector<uint32_t> bodySlot; // Where in that cell
+        std::vector<uint32_t> newCell;  // Cell of every body as of this build
+        uint32_t movedCount = 0;
+
+        // Keeps the covered extent, and empties every cell
+        void setCellSize(float size);
+
+        // Bodies outside the grid are clamped into the border cells, like in Grid
+        uint32_t cellIndex(glm::vec2 pos) const;
+
+        void insert(uint32_t body, uint32_t cell);
+        void remove(uint32_t body);
+    };
+}
@@ -1,9 +1,9 @@
 #include "MeshObject.h"
 
-void MeshObject::draw(VkCommandBuffer& commandBuffer, uint32_t instanceCount, VkPipelineLayout pipelineLayout,uint32_t currentFrame)
+void MeshObject::draw(VkCommandBuffer& commandBuffer, const InstanceCuller& culler, VkPipelineLayout pipelineLayout, uint32_t currentFrame)
 {
     const std::vector<VkBuffer> vertexBuffers = { bufferMan->vertexBuffer };
-    const std::vector<VkBuffer> instanceBuffers = { bufferMan->instanceBuffer };
+    const std::vector<VkBuffer> instanceBuffers = { culler.visibleBuffers[currentFrame] };
     constexpr VkDeviceSize offsets[] = {0, 0};
 
     vkCmdBindVertexBuffers(commandBuffer, 0, vertexBuffers.size(), vertexBuffers.data(), offsets);
@@ -12,5 +12,15 @@ void MeshObject::draw(VkCommandBuffer& commandBuffer, uint32_t instanceCount, Vk
     vkCmdBindIndexBuffer(commandBuffer, bufferMan->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &bufferMan->descriptorSets[currentFrame], 0, nullptr);
 
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), instanceCount, 0, 0, 0);
+    culler.drawIndirect(commandBuffer, currentFrame);
+}
+
+void MeshObject::drawPoints(VkCommandBuffer& commandBuffer, const InstanceCuller& culler, VkPipelineLayout pipelineLayout, uint32_t currentFrame)
+{
+    constexpr VkDeviceSize offset = 0;
+
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, &culler.visibleBuffers[currentFrame], &offset);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &bufferMan->descriptorSets[currentFrame], 0, nullptr);
+
+    culler.drawPointsIndirect(commandBuffer, currentFrame);
 }
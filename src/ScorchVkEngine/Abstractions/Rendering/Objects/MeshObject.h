@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 
 #include <Abstractions/Rendering/BufferManager.h>
+#include <Abstractions/Rendering/InstanceCuller.h>
 
 class MeshObject
 {
@@ -21,7 +22,11 @@ public:
 
     glm::vec2 pos = {0.0f, 0.0f};
 
-    void draw(VkCommandBuffer& commandBuffer, uint32_t instanceCount, VkPipelineLayout pipelineLayout, uint32_t currentFrame);
+    // Draws the instances that survived the frame's cull pass
+    void draw(VkCommandBuffer& commandBuffer, const InstanceCuller& culler, VkPipelineLayout pipelineLayout, uint32_t currentFrame);
+
+    // Draws the same instances as one point sprite each, with no quad and one vertex shader invocation per body
+    void drawPoints(VkCommandBuffer& commandBuffer, const InstanceCuller& culler, VkPipelineLayout pipelineLayout, uint32_t currentFrame);
 
 private:
     BufferManager* bufferMan = BufferManager::getInstance();
@@ -0,0 +1,42 @@
+#include "MortonOrder.h"
+
+#include <numeric>
+
+namespace Physics
+{
+    uint32_t MortonOrder::codeOf(const glm::vec2 pos) const
+    {
+        // Bodies outside the extent share the border cells, like they do in the grid
+        const glm::vec2 local = glm::clamp((pos + 0.5f * extent) / extent, 0.0f, 1.0f) * 65535.0f;
+
+        return MortonCode(static_cast<uint32_t>(local.x), static_cast<uint32_t>(local.y));
+    }
+
+    void MortonOrder::reorder(const std::vector<RigidBody*>& bodies)
+    {
+        const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+
+        codes.resize(bodyCount);
+        order.resize(bodyCount);
+        std::iota(order.begin(), order.end(), 0);
+
+        for (uint32_t i = 0; i < bodyCount; i++) codes[i] = codeOf(bodies[i]->currPos);
+
+        sorter.sort(codes, order);
+
+        // Gather the bodies that change place before any of them is overwritten, then write them to their new places
+        scratch.clear();
+
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            if (order[i] != i) scratch.emplace_back(*bodies[order[i]]);
+        }
+
+        movedCount = static_cast<uint32_t>(scratch.size());
+
+        for (uint32_t i = 0, moved = 0; moved < movedCount; i++)
+        {
+            if (order[i] != i) *bodies[i] = scratch[moved++];
+        }
+    }
+}
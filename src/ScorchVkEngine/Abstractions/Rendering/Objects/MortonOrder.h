@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/RigidBody.h>
+#include <Abstractions/Sorting.h>
+
+namespace Physics
+{
+    // Spreads the low 16 bits of v out to the even bits
+    inline uint32_t PartBy1(uint32_t v)
+    {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+
+        return v;
+    }
+
+    // Z-order curve index of a 16 bit cell coordinate
+    inline uint32_t MortonCode(const uint32_t x, const uint32_t y) { return PartBy1(x) | (PartBy1(y) << 1); }
+
+    // Keeps the bodies in Z-order, so bodies that are close in space are also close in memory, which the broadphase,
+    // the solver and the integrator all walk through. The codes are radix sorted, which costs the same however much the
+    // order changed, and only bodies that change place are copied back.
+    class MortonOrder
+    {
+    public:
+        static constexpr uint32_t reorderInterval = 30; // Frames
+
+        explicit MortonOrder(glm::vec2 worldExtent) : extent(worldExtent) {}
+
+        // Moves the body values behind the pointers into Z-order, the pointers themselves stay where they are
+        void reorder(const std::vector<RigidBody*>& bodies);
+
+        uint32_t getMovedCount() const { return movedCount; }
+
+    private:
+        glm::vec2 extent;
+
+        std::vector<uint32_t> codes;
+        std::vector<uint32_t> order; // Current index of the body that goes at each place
+        Sorting::RadixSorter sorter;
+
+        std::vector<RigidBody> scratch;
+        uint32_t movedCount = 0;
+
+        uint32_t codeOf(glm::vec2 pos) const;
+    };
+}
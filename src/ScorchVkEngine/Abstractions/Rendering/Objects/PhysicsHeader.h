@@ -2,130 +2,94 @@
 
 #include <glm/glm.hpp>
 #include <cmath>
-
-constexpr float rad = 0.5f; // Circle Radius
-constexpr float diam = 1.0f; // Circle Diameter
-
-struct RigidBody
-{
-    glm::vec2      currPos;
-    glm::vec2      prevPos;
-    glm::vec2 acceleration;
-    glm::vec2     velocity;
-
-    uint32_t xIndex;
-
-    RigidBody(glm::vec2 cPos, glm::vec2 pPos, uint32_t i)
-    : currPos(cPos), prevPos(pPos), acceleration(), velocity(cPos - pPos), xIndex(i)
-    {}
-
-    void updatePos(const float dt)
-    {
-        velocity = currPos - prevPos;
-        prevPos = currPos;
-
-        currPos += velocity + acceleration * dt * dt;
-
-        acceleration = {};
-    }
-
-    void accelerate(const glm::vec2 acc){ acceleration += acc; }
-};
-
-struct ShelfBook
-{
-    std::vector<RigidBody*> rBodies;
-
-    ShelfBook()
-    {
-        rBodies.reserve(512);
-    }
-};
-
-struct Shelf
-{
-    std::vector<ShelfBook> books{128};
-
-    void write(RigidBody* body) { books[floor(body->currPos.x + 64)].rBodies.emplace_back(body); }
-    void erase() { for (ShelfBook book : books) book.rBodies.clear(); }
-};
+#include <vector>
+#include <algorithm>
+
+#include <Abstractions/Rendering/Objects/RigidBody.h>
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+#include <Abstractions/Rendering/Objects/Grid.h>
+#include <Abstractions/Rendering/Objects/IncrementalGrid.h>
+#include <Abstractions/Rendering/Objects/HierarchicalGrid.h>
+#include <Abstractions/Rendering/Objects/AABBTree.h>
+#include <Abstractions/Rendering/Objects/SortAndSweep.h>
+#include <Abstractions/Rendering/Objects/MortonOrder.h>
+#include <Abstractions/Rendering/Objects/ContactSolver.h>
+#include <Abstractions/Rendering/Objects/PhysicsStats.h>
+#include <Abstractions/JobSystem.h>
+#include <Abstractions/Profiler.h>
 
 namespace Physics
 {
     constexpr uint32_t subSteps = 16;
     constexpr glm::vec2 gravity = { 0.0f, -100.0f };
     constexpr float boundsX{64.0f}, boundsY{36.0f}; // IMPLEMENT AUTOMATIC BOUND UPDATING TO SCREEN WIDTH & HEIGHT
+    constexpr uint32_t bodiesPerJob = 4096;
 
-    inline void SolveCollisions(RigidBody* body1, RigidBody* body2)
+    // Returns how far the bodies overlapped, zero when they did not
+    inline float SolveCollisions(RigidBody* body1, RigidBody* body2)
     {
         const glm::vec2 collisionAxis = body1->currPos - body2->currPos;
 
         const float squareDistance = collisionAxis.x * collisionAxis.x + collisionAxis.y * collisionAxis.y;
 
-        if (squareDistance < diam * diam)
+        const float minDistance = body1->radius + body2->radius;
+        const float totalInvMass = body1->invMass + body2->invMass;
+
+        if (squareDistance < minDistance * minDistance && squareDistance > 0.0f && totalInvMass > 0.0f)
         {
             const float distance = sqrt(squareDistance);
             const glm::vec2 n = collisionAxis / distance;
-            const float delta = diam - distance;
-            body1->currPos += 0.5f * delta * n;
-            body2->currPos -= 0.5f * delta * n;
-        }
-    }
-
-    inline void CheckBooksCollision(ShelfBook& book1, ShelfBook& book2)
-    {
-        /*for (RigidBody* body1 : book1.rBodies)
-            for (RigidBody* body2 : book2.rBodies)
-                if (body1->xIndex != body2->xIndex)
-                    if (fabs(body1->currPos.x - body2->currPos.x < diam))
-                        SolveCollisions(body1, body2);*/
+            const float delta = minDistance - distance;
 
-        for (uint32_t i = 0; i < book1.rBodies.size(); i++)
-        {
-            RigidBody* body1 = book1.rBodies[i];
-
-            for (uint32_t j = 0; j < book2.rBodies.size(); j++)
-            {
-                RigidBody* body2 = book2.rBodies[j];
+            // The lighter body takes the larger share of the correction
+            body1->currPos += body1->invMass / totalInvMass * delta * n;
+            body2->currPos -= body2->invMass / totalInvMass * delta * n;
 
-                if (body1->xIndex == body2->xIndex) break;
-
-                if (fabs(body1->currPos.x - body2->currPos.x < diam)) SolveCollisions(body1, body2);
-            }
+            return delta;
         }
+
+        return 0.0f;
     }
 
-    inline void Update(std::vector<RigidBody*>& rBodies, Shelf& shelf, const float deltaTime)
+    inline void Update(std::vector<RigidBody*>& rBodies, Broadphase& broadphase, ContactSolver& solver, const float deltaTime)
     {
+        SCORCH_PROFILE_SCOPE("Physics::Update");
+
         const float subDeltaTime = deltaTime / subSteps;
+        const uint32_t bodyCount = static_cast<uint32_t>(rBodies.size());
+        JobSystem* jobSystem = JobSystem::getInstance();
 
         for (uint32_t ss = subSteps; ss--;)
         {
-            for (RigidBody* body : rBodies)
             {
-                body->accelerate(gravity);
-
-                // Set Bounding Box
-                if (fabs(body->currPos.x) > boundsX - rad)
-                    body->currPos.x > 0 ? body->currPos.x *= (boundsX - rad) / body->currPos.x : body->currPos.x *= (boundsX - rad) / -body->currPos.x;
-                if (fabs(body->currPos.y) > boundsY - rad)
-                    body->currPos.y > 0 ? body->currPos.y *= (boundsY - rad) / body->currPos.y : body->currPos.y *= (boundsY - rad) / -body->currPos.y;
+                SCORCH_PROFILE_SCOPE("Integrate");
 
-                shelf.write(body);
+                jobSystem->parallelFor(bodyCount, bodiesPerJob, [&](const uint32_t first, const uint32_t last)
+                {
+                    for (uint32_t i = first; i < last; i++)
+                    {
+                        RigidBody* body = rBodies[i];
+                        body->accelerate(gravity);
+
+                        // Set Bounding Box
+                        const float r = body->radius;
+                        if (fabs(body->currPos.x) > boundsX - r)
+                            body->currPos.x > 0 ? body->currPos.x *= (boundsX - r) / body->currPos.x : body->currPos.x *= (boundsX - r) / -body->currPos.x;
+                        if (fabs(body->currPos.y) > boundsY - r)
+                            body->currPos.y > 0 ? body->currPos.y *= (boundsY - r) / body->currPos.y : body->currPos.y *= (boundsY - r) / -body->currPos.y;
+                    }
+                });
             }
 
-            for (int i = 1; i < 127; ++i)
             {
-                ShelfBook& currentBook = shelf.books[i];
-
-                for (int j = -1; j < 2; ++j)
-                {
-                    ShelfBook& otherBook = shelf.books[i + j];
-                    CheckBooksCollision(currentBook, otherBook);
-                }
+                SCORCH_PROFILE_SCOPE("Broadphase");
+                broadphase.build(rBodies);
             }
 
-            shelf.erase();
+            {
+                SCORCH_PROFILE_SCOPE("Solve");
+                solver.solve(rBodies, broadphase);
+            }
 
             /*for (uint32_t i = 0; i < rBodies.size(); i++)
             {
@@ -139,7 +103,14 @@ namespace Physics
             }*/
 
             // Apply Updated Position
-            for (RigidBody* body : rBodies) body->updatePos(subDeltaTime);
+            {
+                SCORCH_PROFILE_SCOPE("Update Positions");
+
+                jobSystem->parallelFor(bodyCount, bodiesPerJob, [&](const uint32_t first, const uint32_t last)
+                {
+                    for (uint32_t i = first; i < last; i++) rBodies[i]->updatePos(subDeltaTime);
+                });
+            }
         }
     }
 }
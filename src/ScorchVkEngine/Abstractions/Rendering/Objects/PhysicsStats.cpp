@@ -0,0 +1,71 @@
+#define FMT_HEADER_ONLY
+#include "PhysicsStats.h"
+
+#include <cstdio>
+
+#include <fmt/core.h>
+
+namespace Physics
+{
+    PhysicsStats::Counters& PhysicsStats::addThread()
+    {
+        std::lock_guard lock(countersMutex);
+
+        counters.emplace_back(std::make_unique<Counters>());
+        currentCounters = counters.back().get();
+
+        return *currentCounters;
+    }
+
+    void PhysicsStats::endFrame(const Broadphase& broadphase, FrameStats& stats)
+    {
+        stats.candidatePairs = 0;
+        stats.overlaps = 0;
+        stats.maxPenetration = 0.0f;
+
+        {
+            std::lock_guard lock(countersMutex);
+
+            for (const std::unique_ptr<Counters>& threadCounters : counters)
+            {
+                stats.candidatePairs += threadCounters->candidatePairs;
+                stats.overlaps += threadCounters->overlaps;
+                stats.maxPenetration = std::max(stats.maxPenetration, threadCounters->maxPenetration);
+                *threadCounters = {};
+            }
+        }
+
+        stats.occupancy.assign(occupancyBuckets, 0);
+        broadphase.addOccupancy(stats.occupancy);
+
+        // Broadphases without cells leave nothing to show
+        if (std::all_of(stats.occupancy.begin(), stats.occupancy.end(), [](const uint32_t count) { return count == 0; })) stats.occupancy.clear();
+    }
+
+    void PhysicsStats::writeCsv(const std::string& path, const std::vector<FrameStats>& frames)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file)
+        {
+            fmt::print(fmterr, "Failed to open {} for the physics statistics!\n", path);
+            return;
+        }
+
+        fmt::print(file, "frame,candidatePairs,overlaps,maxPenetration");
+        for (uint32_t n = 0; n < occupancyBuckets; n++) fmt::print(file, ",cells{}{}", n, n + 1 < occupancyBuckets ? "" : "+");
+        fmt::print(file, "\n");
+
+        for (size_t frame = 0; frame < frames.size(); frame++)
+        {
+            const FrameStats& stats = frames[frame];
+            fmt::print(file, "{},{},{},{}", frame, stats.candidatePairs, stats.overlaps, stats.maxPenetration);
+
+            for (uint32_t n = 0; n < occupancyBuckets; n++) fmt::print(file, ",{}", n < stats.occupancy.size() ? stats.occupancy[n] : 0);
+            fmt::print(file, "\n");
+        }
+
+        std::fclose(file);
+
+        fmt::print("Wrote {} frames of physics statistics to {}\n", frames.size(), path);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+
+// Statistics are kept unless SCORCH_NO_STATS is defined, which turns every SCORCH_STAT into nothing
+#ifndef SCORCH_NO_STATS
+#define SCORCH_STATS
+#define SCORCH_STAT(...) __VA_ARGS__
+#else
+#define SCORCH_STAT(...)
+#endif
+
+namespace Physics
+{
+    // What the solver saw over one simulation frame, every sub-step included
+    struct FrameStats
+    {
+        uint64_t candidatePairs = 0; // Pairs the broadphase handed over
+        uint64_t overlaps = 0;       // Of those, the ones that actually overlapped
+        float maxPenetration = 0.0f;
+        std::vector<uint32_t> occupancy; // Cells holding n bodies after the last build at [n], the last bucket is n or more
+    };
+
+    // Counters for the solver, one set per thread. A thread only ever writes its own, and they are summed and cleared
+    // while no physics job runs, so they need neither atomics nor locks.
+    class PhysicsStats
+    {
+    public:
+        // A function-local static, since the first call can come from several job workers at once
+        static PhysicsStats* getInstance()
+        {
+            static PhysicsStats instance;
+            return &instance;
+        }
+
+        static constexpr uint32_t occupancyBuckets = 16;
+
+        // Adds a batch of pairs the calling thread solved
+        void add(const uint64_t candidatePairs, const uint64_t overlaps, const float maxPenetration)
+        {
+            Counters& counters = currentCounters ? *currentCounters : addThread();
+            counters.candidatePairs += candidatePairs;
+            counters.overlaps += overlaps;
+            counters.maxPenetration = std::max(counters.maxPenetration, maxPenetration);
+        }
+
+        // Sums and clears every thread's counters into stats, along with the occupancy of broadphase.
+        // Only while no physics job runs.
+        void endFrame(const Broadphase& broadphase, FrameStats& stats);
+
+        // One row per frame, with a header naming the columns
+        static void writeCsv(const std::string& path, const std::vector<FrameStats>& frames);
+
+    private:
+        struct Counters
+        {
+            uint64_t candidatePairs = 0;
+            uint64_t overlaps = 0;
+            float maxPenetration = 0.0f;
+        };
+
+        PhysicsStats() {}
+
+        std::mutex countersMutex;
+        std::vector<std::unique_ptr<Counters>> counters; // Never freed, like the profiler's thread logs
+
+        inline static thread_local Counters* currentCounters = nullptr;
+
+        Counters& addThread();
+    };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+constexpr float rad = 0.5f; // Default Circle Radius
+constexpr float diam = 1.0f; // Default Circle Diameter
+
+struct RigidBody
+{
+    glm::vec2      currPos;
+    glm::vec2      prevPos;
+    glm::vec2 acceleration;
+    glm::vec2     velocity;
+
+    float   radius;
+    float invMass; // Zero for bodies that collisions cannot push
+
+    uint32_t xIndex;
+
+    // Mass scales with area, so a body of the default radius weighs one
+    RigidBody(glm::vec2 cPos, glm::vec2 pPos, uint32_t i = 0, float r = rad)
+    : currPos(cPos), prevPos(pPos), acceleration(), velocity(cPos - pPos), radius(r), invMass((rad * rad) / (r * r)), xIndex(i)
+    {}
+
+    void updatePos(const float dt)
+    {
+        velocity = currPos - prevPos;
+        prevPos = currPos;
+
+        currPos += velocity + acceleration * dt * dt;
+
+        acceleration = {};
+    }
+
+    void accelerate(const glm::vec2 acc){ acceleration += acc; }
+};
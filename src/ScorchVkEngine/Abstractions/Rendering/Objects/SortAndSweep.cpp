@@ -0,0 +1,77 @@
+#include "SortAndSweep.h"
+
+#include <algorithm>
+
+#include <Abstractions/Sorting.h>
+
+namespace Physics
+{
+    void SortAndSweep::build(const std::vector<RigidBody*>& bodies)
+    {
+        const uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+
+        glm::vec2 low{0.0f}, high{0.0f};
+        if (bodyCount) low = high = bodies[0]->currPos;
+
+        maxWidth = 0.0f;
+        for (const RigidBody* body : bodies)
+        {
+            low = glm::min(low, body->currPos);
+            high = glm::max(high, body->currPos);
+            maxWidth = std::max(maxWidth, 2.0f * body->radius);
+        }
+
+        // Sweeping along the longer side leaves fewer bodies overlapping on the sweep axis
+        axis = high.x - low.x >= high.y - low.y ? 0 : 1;
+
+        // Drop bodies that are gone and append the new ones, which the sort then moves into place
+        std::erase_if(order, [bodyCount](const uint32_t body) { return body >= bodyCount; });
+        for (uint32_t i = static_cast<uint32_t>(bodyRank.size()); i < bodyCount; i++) order.push_back(i);
+
+        Sorting::sortNearlySorted(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b)
+        {
+            return bodies[a]->currPos[axis] - bodies[a]->radius < bodies[b]->currPos[axis] - bodies[b]->radius;
+        });
+
+        intervals.resize(bodyCount);
+        bodyRank.resize(bodyCount);
+
+        for (uint32_t r = 0; r < bodyCount; r++)
+        {
+            const RigidBody* body = bodies[order[r]];
+
+            intervals[r] = { body->currPos[axis] - body->radius, body->currPos[axis] + body->radius,
+                             body->currPos[1 - axis] - body->radius, body->currPos[1 - axis] + body->radius, order[r] };
+            bodyRank[order[r]] = r;
+        }
+    }
+
+    void SortAndSweep::findPairs(std::vector<BodyPair>& pairs) const
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(intervals.size()); i++)
+        {
+            const Interval& a = intervals[i];
+
+            for (uint32_t j = i + 1; j < static_cast<uint32_t>(intervals.size()) && intervals[j].min <= a.max; j++)
+            {
+                const Interval& b = intervals[j];
+                if (a.crossMin <= b.crossMax && b.crossMin <= a.crossMax) pairs.push_back({a.body, b.body});
+            }
+        }
+    }
+
+    void SortAndSweep::findNeighbours(const uint32_t body, std::vector<uint32_t>& neighbours) const
+    {
+        const uint32_t rank = bodyRank[body];
+        const Interval& a = intervals[rank];
+
+        auto test = [&](const Interval& b)
+        {
+            if (b.max >= a.min && b.min <= a.max && a.crossMin <= b.crossMax && b.crossMin <= a.crossMax) neighbours.push_back(b.body);
+        };
+
+        // Earlier intervals can reach at most one full width past their low edge
+        for (uint32_t j = rank; j-- > 0 && intervals[j].min >= a.min - maxWidth;) test(intervals[j]);
+        for (uint32_t j = rank + 1; j < static_cast<uint32_t>(intervals.size()) && intervals[j].min <= a.max; j++) test(intervals[j]);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Abstractions/Rendering/Objects/Broadphase.h>
+
+namespace Physics
+{
+    // Sorts the bodies by the low edge of their bounds along the axis they are most spread out on, then sweeps along it.
+    // The order from the previous build is kept and only touched up, since bodies barely move between substeps.
+    // Needs no extent or cell size, and pairs with MortonOrder keeping the body memory in spatial order.
+    class SortAndSweep : public Broadphase
+    {
+    public:
+        void build(const std::vector<RigidBody*>& bodies) override;
+        void findPairs(std::vector<BodyPair>& pairs) const override;
+        void findNeighbours(uint32_t body, std::vector<uint32_t>& neighbours) const override;
+
+        int getAxis() const { return axis; }
+
+    private:
+        struct Interval
+        {
+            float min, max;   // Along the sweep axis
+            float crossMin, crossMax;
+            uint32_t body;
+        };
+
+        int axis = 0;
+        float maxWidth = 0.0f;
+
+        std::vector<uint32_t> order;     // Body indices sorted by their low edge, kept between builds
+        std::vector<Interval> intervals; // In sweep order
+        std::vector<uint32_t> bodyRank;  // Position of every body in intervals
+    };
+}
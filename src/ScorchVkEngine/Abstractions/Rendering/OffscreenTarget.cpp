@@ -0,0 +1,129 @@
+#define FMT_HEADER_ONLY
+#include "OffscreenTarget.h"
+
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+void OffscreenTarget::createTarget()
+{
+    frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    std::filesystem::create_directories(directory);
+    writer = std::make_unique<FrameWriter>();
+
+    images.resize(presentMan->framesInFlight);
+    imageAllocations.resize(presentMan->framesInFlight);
+    imageViews.resize(presentMan->framesInFlight);
+    readbackBuffers.resize(presentMan->framesInFlight);
+    readbackAllocations.resize(presentMan->framesInFlight);
+    readbackMapped.resize(presentMan->framesInFlight);
+    pendingFrames.assign(presentMan->framesInFlight, -1);
+
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VmaAllocationCreateInfo imageAllocInfo{};
+        imageAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+        if (vmaCreateImage(bufferMan->VMA.allocator, &imageInfo, &imageAllocInfo, &images[i], &imageAllocations[i], nullptr) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create an offscreen image!");
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        if (vkCreateImageView(presentMan->device, &viewInfo, nullptr, &imageViews[i]) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create an offscreen image view!");
+
+        // Read on the CPU, so cached memory is preferred over write combined
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = frameSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo bufferAllocInfo{};
+        bufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        bufferAllocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VmaAllocationInfo allocInfo;
+        if (vmaCreateBuffer(bufferMan->VMA.allocator, &bufferInfo, &bufferAllocInfo, &readbackBuffers[i], &readbackAllocations[i], &allocInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create an offscreen readback buffer!");
+
+        readbackMapped[i] = allocInfo.pMappedData;
+    }
+}
+
+void OffscreenTarget::destroyTarget()
+{
+    writer.reset();
+
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        vmaDestroyBuffer(bufferMan->VMA.allocator, readbackBuffers[i], readbackAllocations[i]);
+        vkDestroyImageView(presentMan->device, imageViews[i], nullptr);
+        vmaDestroyImage(bufferMan->VMA.allocator, images[i], imageAllocations[i]);
+    }
+}
+
+void OffscreenTarget::recordReadback(VkCommandBuffer commandBuffer, const uint32_t currentFrame)
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0; // Tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { extent.width, extent.height, 1 };
+
+    vkCmdCopyImageToBuffer(commandBuffer, images[currentFrame], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffers[currentFrame], 1, &region);
+
+    // The fence alone does not make the copy visible to the host
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = readbackBuffers[currentFrame];
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    pendingFrames[currentFrame] = nextFrame++;
+}
+
+void OffscreenTarget::collect(const uint32_t currentFrame)
+{
+    const int64_t frame = pendingFrames[currentFrame];
+    if (frame < 0) return;
+    pendingFrames[currentFrame] = -1;
+
+    vmaInvalidateAllocation(bufferMan->VMA.allocator, readbackAllocations[currentFrame], 0, VK_WHOLE_SIZE);
+
+    // Copied out so the slot can be read back into again straight away, the writer takes it from there
+    std::vector<uint8_t> pixels = writer->takeBuffer(frameSize);
+    std::memcpy(pixels.data(), readbackMapped[currentFrame], frameSize);
+
+    const std::string path = fmt::format("{}/frame_{:06}.{}", directory, frame, frameFormat == FrameFormat::Png ? "png" : "rgba");
+    writer->write(path, extent.width, extent.height, frameFormat, std::move(pixels));
+}
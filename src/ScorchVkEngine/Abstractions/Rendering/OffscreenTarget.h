@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Abstractions/Rendering/BufferManager.h>
+#include <Abstractions/PresentationManager.h>
+#include <Abstractions/FrameWriter.h>
+
+// Stands in for the swap chain when rendering without a display. Every frame in flight renders into an image of its
+// own, which is copied into a host visible buffer at the end of the frame. Once the frame's fence has signalled the
+// pixels are handed to a writer thread, so the render thread never waits on the copy or the disk.
+class OffscreenTarget
+{
+public:
+    // sRGB like the swap chain, so the frames come out as they look on screen
+    static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+
+    VkExtent2D extent = { 1920, 1080 };
+    std::string directory = "frames";
+    FrameFormat frameFormat = FrameFormat::Png;
+
+    void createTarget();
+    void destroyTarget(); // Waits for the frames still being written
+
+    VkImage getImage(uint32_t currentFrame) const { return images[currentFrame]; }
+    VkImageView getImageView(uint32_t currentFrame) const { return imageViews[currentFrame]; }
+
+    // Copies the frame out once rendering has ended and the image is in TRANSFER_SRC_OPTIMAL
+    void recordReadback(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+    // Hands the last frame read back into this slot to the writer. Only once its fence has signalled.
+    void collect(uint32_t currentFrame);
+
+private:
+    PresentationManager* presentMan = PresentationManager::getInstance();
+    BufferManager* bufferMan = BufferManager::getInstance();
+
+    VkDeviceSize frameSize = 0;
+    uint32_t nextFrame = 0;
+
+    std::vector<VkImage> images;
+    std::vector<VmaAllocation> imageAllocations;
+    std::vector<VkImageView> imageViews;
+
+    std::vector<VkBuffer> readbackBuffers;
+    std::vector<VmaAllocation> readbackAllocations;
+    std::vector<void*> readbackMapped;
+    std::vector<int64_t> pendingFrames; // The frame number read back into each slot, negative when there is none
+
+    std::unique_ptr<FrameWriter> writer;
+};
@@ -27,8 +27,23 @@ Shader::Shader(const std::string& vert, const std::string& frag)
     shaderStages[1] = fragShaderStageInfo;
 }
 
+Shader::Shader(const std::string& comp)
+{
+    compShaderModule = createShaderModule(readFile(comp));
+
+    VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+    compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    compShaderStageInfo.module = compShaderModule;
+    compShaderStageInfo.pName = "main";
+
+    stageCount = 1;
+    shaderStages[0] = compShaderStageInfo;
+}
+
 void Shader::destroyShader()
 {
+    vkDestroyShaderModule(presentMan->device, compShaderModule, nullptr);
     vkDestroyShaderModule(presentMan->device, fragShaderModule, nullptr);
     vkDestroyShaderModule(presentMan->device, vertShaderModule, nullptr);
 }
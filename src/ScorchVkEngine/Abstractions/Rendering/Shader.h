@@ -14,13 +14,15 @@ public:
     VkPipelineShaderStageCreateInfo shaderStages[2] = {};
 
     Shader(const std::string& vert, const std::string& frag);
+    explicit Shader(const std::string& comp); // A single compute stage, in shaderStages[0]
     void destroyShader();
 
 private:
     PresentationManager* presentMan = PresentationManager::getInstance();
 
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+    VkShaderModule vertShaderModule{};
+    VkShaderModule fragShaderModule{};
+    VkShaderModule compShaderModule{};
 
     VkShaderModule createShaderModule(const std::vector<char>& code);
     static std::vector<char> readFile(const std::string& filename);
@@ -0,0 +1,86 @@
+#include "Sorting.h"
+
+#include <Abstractions/JobSystem.h>
+
+namespace Sorting
+{
+    constexpr size_t minChunkSize = 1 << 16; // Below this, a thread spends longer starting than sorting
+
+    void RadixSorter::sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values)
+    {
+        const size_t count = keys.size();
+        if (count < 2) return;
+
+        JobSystem* jobSystem = JobSystem::getInstance();
+
+        const size_t threadCount = jobSystem->getThreadCount();
+        const size_t chunkCount = std::clamp<size_t>(count / minChunkSize, 1, threadCount);
+        const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+        keyScratch.resize(count);
+        valueScratch.resize(count);
+        histograms.resize(chunkCount);
+
+        std::vector<uint32_t>* srcKeys = &keys;
+        std::vector<uint32_t>* srcValues = &values;
+        std::vector<uint32_t>* dstKeys = &keyScratch;
+        std::vector<uint32_t>* dstValues = &valueScratch;
+
+        for (uint32_t shift = 0; shift < 32; shift += radixBits)
+        {
+            jobSystem->parallelFor(static_cast<uint32_t>(chunkCount), 1, [&](const uint32_t chunk, uint32_t)
+            {
+                std::array<uint32_t, bucketCount>& histogram = histograms[chunk];
+                histogram.fill(0);
+
+                const size_t last = std::min(count, (chunk + 1) * chunkSize);
+                for (size_t i = chunk * chunkSize; i < last; i++) histogram[((*srcKeys)[i] >> shift) & (bucketCount - 1)]++;
+            });
+
+            // Turn the counts into where every chunk writes each digit: all smaller digits first, then earlier chunks
+            uint32_t offset = 0;
+            bool sameDigit = false;
+
+            for (uint32_t digit = 0; digit < bucketCount; digit++)
+            {
+                const uint32_t digitStart = offset;
+
+                for (std::array<uint32_t, bucketCount>& histogram : histograms)
+                {
+                    const uint32_t digitCount = histogram[digit];
+                    histogram[digit] = offset;
+                    offset += digitCount;
+                }
+
+                if (offset - digitStart == count) sameDigit = true;
+            }
+
+            if (sameDigit) continue;
+
+            jobSystem->parallelFor(static_cast<uint32_t>(chunkCount), 1, [&](const uint32_t chunk, uint32_t)
+            {
+                std::array<uint32_t, bucketCount>& cursor = histograms[chunk];
+
+                const size_t last = std::min(count, (chunk + 1) * chunkSize);
+                for (size_t i = chunk * chunkSize; i < last; i++)
+                {
+                    const uint32_t key = (*srcKeys)[i];
+                    const uint32_t slot = cursor[(key >> shift) & (bucketCount - 1)]++;
+
+                    (*dstKeys)[slot] = key;
+                    (*dstValues)[slot] = (*srcValues)[i];
+                }
+            });
+
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+
+        // An odd number of passes leaves the result in the scratch buffers
+        if (srcKeys != &keys)
+        {
+            keys.swap(keyScratch);
+            values.swap(valueScratch);
+        }
+    }
+}
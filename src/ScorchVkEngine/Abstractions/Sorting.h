@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Sorting
+{
+    // Insertion sort for data that was sorted last frame and has barely changed since. Once it has shifted more than a
+    // few elements per entry it hands over to std::sort, so shuffled input still costs O(n log n).
+    template<typename It, typename Compare>
+    void sortNearlySorted(const It first, const It last, Compare comp)
+    {
+        constexpr std::ptrdiff_t shiftsPerElement = 8;
+        std::ptrdiff_t budget = shiftsPerElement * std::distance(first, last);
+
+        for (It i = first; i != last; ++i)
+        {
+            auto value = std::move(*i);
+            It j = i;
+
+            for (; j != first && comp(value, *std::prev(j)); --j)
+            {
+                *j = std::move(*std::prev(j));
+
+                if (--budget < 0)
+                {
+                    *std::prev(j) = std::move(value);
+                    std::sort(first, last, comp);
+                    return;
+                }
+            }
+
+            *j = std::move(value);
+        }
+    }
+
+    // Stable LSD radix sort of 32 bit keys carrying a 32 bit value each, eight bits per pass. Every pass counts the
+    // digits of each chunk of the input in parallel, prefix sums the counts and scatters the chunks in parallel.
+    // Passes where all keys share the digit are skipped. The scratch buffers are kept between sorts.
+    class RadixSorter
+    {
+    public:
+        void sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values);
+
+    private:
+        static constexpr uint32_t radixBits = 8;
+        static constexpr uint32_t bucketCount = 1 << radixBits;
+
+        std::vector<uint32_t> keyScratch, valueScratch;
+        std::vector<std::array<uint32_t, bucketCount>> histograms; // One per chunk
+    };
+}
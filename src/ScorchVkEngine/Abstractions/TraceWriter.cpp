@@ -0,0 +1,59 @@
+#define FMT_HEADER_ONLY
+#include "TraceWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <fmt/core.h>
+
+void TraceWriter::write(std::string path, std::vector<std::string> threadNames, std::vector<TraceEvent> events)
+{
+    finish();
+
+    writing = true;
+    writer = std::thread([this, path = std::move(path), threadNames = std::move(threadNames), events = std::move(events)]
+    {
+        writeFile(path, threadNames, events);
+        writing = false;
+    });
+}
+
+void TraceWriter::finish()
+{
+    if (writer.joinable()) writer.join();
+}
+
+void TraceWriter::writeFile(const std::string& path, const std::vector<std::string>& threadNames, const std::vector<TraceEvent>& events)
+{
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        fmt::print(fmterr, "Failed to open {} for the trace!\n", path);
+        return;
+    }
+
+    // Times are in microseconds from the first event of the capture
+    uint64_t origin = UINT64_MAX;
+    for (const TraceEvent& event : events) origin = std::min(origin, event.start);
+
+    fmt::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for (uint32_t thread = 0; thread < threadNames.size(); thread++)
+    {
+        fmt::print(file, "{}\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", thread ? "," : "", thread, threadNames[thread]);
+        fmt::print(file, ",\n{{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"sort_index\":{}}}}}", thread, thread);
+    }
+
+    const char* separator = threadNames.empty() ? "" : ",";
+    for (const TraceEvent& event : events)
+    {
+        fmt::print(file, "{}\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}", separator, event.name, event.thread,
+                   static_cast<double>(event.start - origin) * 1e-3, static_cast<double>(event.end - event.start) * 1e-3);
+        separator = ",";
+    }
+
+    fmt::print(file, "\n]}}\n");
+    std::fclose(file);
+
+    fmt::print("Wrote {} trace events to {}\n", events.size(), path);
+}
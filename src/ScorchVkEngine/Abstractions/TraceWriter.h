@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A complete event of a capture, and the thread it ran on as an index into the capture's thread names
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start, end; // Nanoseconds
+    uint32_t thread;
+};
+
+// Writes profiler captures in the Chrome Trace Event format, which chrome://tracing and Perfetto both open. Captures
+// are kept in memory while they run, then formatted and written on a thread of their own so no frame waits on the disk.
+class TraceWriter
+{
+public:
+    ~TraceWriter() { finish(); }
+
+    // Takes the capture over. A capture that is still being written is finished first.
+    void write(std::string path, std::vector<std::string> threadNames, std::vector<TraceEvent> events);
+
+    // Waits for the capture being written, if any
+    void finish();
+
+    bool isWriting() const { return writing.load(std::memory_order_relaxed); }
+
+private:
+    std::thread writer;
+    std::atomic<bool> writing{false};
+
+    static void writeFile(const std::string& path, const std::vector<std::string>& threadNames, const std::vector<TraceEvent>& events);
+};
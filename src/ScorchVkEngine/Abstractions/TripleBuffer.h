@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-over of the newest value from one writer thread to one reader thread. Each side owns one slot, and the
+// third sits in the middle: the writer publishes by swapping its slot into the middle, and the reader takes the middle
+// slot for its own when it holds something newer. Neither side ever blocks the other.
+template<typename T>
+class TripleBuffer
+{
+public:
+    T& writeSlot() { return slots[writeIndex]; }
+    T& readSlot() { return slots[readIndex]; }
+
+    void publish()
+    {
+        writeIndex = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+        middle.notify_one();
+    }
+
+    // Makes the newest published value the read slot, returns false if nothing was published since the last call
+    bool acquire()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & freshBit)) return false;
+
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        middle.notify_one();
+
+        return true;
+    }
+
+    // Lets the writer pace itself to the reader: returns once the last published value has been taken, or once running
+    // goes false and the reader has called acquire
+    void waitUntilTaken(const std::atomic<bool>& running) const
+    {
+        uint8_t current = middle.load(std::memory_order_acquire);
+
+        while ((current & freshBit) && running.load(std::memory_order_relaxed))
+        {
+            middle.wait(current, std::memory_order_acquire);
+            current = middle.load(std::memory_order_acquire);
+        }
+    }
+
+private:
+    static constexpr uint8_t indexMask = 0x3;
+    static constexpr uint8_t freshBit = 0x4;
+
+    T slots[3];
+    uint8_t writeIndex = 0;
+    uint8_t readIndex = 1;
+    std::atomic<uint8_t> middle{2};
+};
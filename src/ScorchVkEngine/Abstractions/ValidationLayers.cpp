@@ -102,13 +102,37 @@ std::vector<const char*> ValidationLayers::getRequiredExtensions()
     uint32_t glfwExtensionCount = 0;
     const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // None when GLFW was never initialised, for rendering offscreen
+    std::vector<const char*> extensions;
+    if (glfwExtensions) extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
     if (enableValidationLayers) extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
+    surfaceMaintenance = glfwExtensions && checkInstanceExtensionSupport(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME) &&
+                         checkInstanceExtensionSupport(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+    if (surfaceMaintenance)
+    {
+        extensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+    }
+
     return extensions;
 }
 
+bool ValidationLayers::checkInstanceExtensionSupport(const char* extension)
+{
+    uint32_t extensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& available : availableExtensions)
+        if (strcmp(available.extensionName, extension) == 0) return true;
+
+    return false;
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL ValidationLayers::debugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT msgSeverity,
         VkDebugUtilsMessageTypeFlagsEXT msgType,
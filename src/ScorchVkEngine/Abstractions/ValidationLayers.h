@@ -19,6 +19,9 @@ public:
 
     bool enableValidationLayers = vLEnabled;
 
+    // VK_EXT_surface_maintenance1, which a device needs for VK_EXT_swapchain_maintenance1. Enabled when the loader has it.
+    bool surfaceMaintenance = false;
+
     void passDebugDataToInstance(VkInstanceCreateInfo& createInfo);
     void setupDebugMessenger(const VkInstance& instance);
     void destroyDebugMessenger(const VkInstance& instance);
@@ -36,6 +39,7 @@ private:
 
     static void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     bool checkValidationLayerSupport();
+    static bool checkInstanceExtensionSupport(const char* extension);
     std::vector<const char*> getRequiredExtensions();
 
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
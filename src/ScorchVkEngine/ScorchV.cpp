@@ -1,9 +1,13 @@
-#define MAX_FRAMES_IN_FLIGHT 2
 #define FMT_HEADER_ONLY
 #include "ScorchV.h"
 
 #include <stdexcept>
+#include <exception>
 #include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <iterator>
+#include <thread>
 
 #include <Abstractions/Rendering/Shader.h>
 
@@ -11,6 +15,42 @@
 
 constexpr uint32_t WIDTH = 800;
 constexpr uint32_t HEIGHT = 600;
+constexpr uint32_t instancesPerJob = 8192;
+constexpr const char* statsPath = "physics_stats.csv";
+
+constexpr VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+constexpr const char* presentModeNames[] = { "Immediate", "Mailbox", "FIFO", "FIFO Relaxed" };
+
+const char* presentModeName(const VkPresentModeKHR mode)
+{
+    for (size_t i = 0; i < std::size(presentModes); i++) if (presentModes[i] == mode) return presentModeNames[i];
+    return "Other";
+}
+
+// With dynamic rendering nothing transitions the target for us, a render pass used to do it on begin and end
+void transitionImage(VkCommandBuffer commandBuffer, VkImage image, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+                     const VkPipelineStageFlags2 srcStage, const VkAccessFlags2 srcAccess, const VkPipelineStageFlags2 dstStage, const VkAccessFlags2 dstAccess)
+{
+    VkImageMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = srcStage;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstStageMask = dstStage;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
 
 void ScorchV::initWindow()
 {
@@ -21,73 +61,429 @@ void ScorchV::initWindow()
     window = glfwCreateWindow(WIDTH, HEIGHT, "Scorch-V", nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, presentMan->framebufferResizeCallback);
-    glfwSwapInterval(1);
+    glfwSetScrollCallback(window, scrollCallback);
+}
+
+void ScorchV::scrollCallback(GLFWwindow* window, double xOffset, double yOffset)
+{
+    if (ImGui::GetCurrentContext() && ImGui::GetIO().WantCaptureMouse) return;
+
+    const auto app = static_cast<ScorchV*>(glfwGetWindowUserPointer(window));
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    app->camera.zoomAt(app->cursorPosition(), { static_cast<float>(width), static_cast<float>(height) }, std::pow(1.1f, static_cast<float>(yOffset)));
+}
+
+glm::vec2 ScorchV::cursorPosition() const
+{
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+
+    // The cursor is in screen coordinates, which differ from framebuffer pixels on high DPI displays
+    int windowWidth, windowHeight, width, height;
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    glfwGetFramebufferSize(window, &width, &height);
+
+    if (windowWidth == 0 || windowHeight == 0) return { 0.0f, 0.0f };
+
+    return { static_cast<float>(x * width / windowWidth), static_cast<float>(y * height / windowHeight) };
 }
 
 void ScorchV::mainLoop()
 {
-    rBodies.reserve(100000);
     vertInstances.reserve(100000);
 
+    simRunning = true;
+    simThread = std::thread(&ScorchV::simulate, this);
+
+    int broadphaseIndex = simSettings.broadphaseIndex;
+    int solverMode = static_cast<int>(simSettings.solverMode.load());
+    float spawnRadius[2] = { simSettings.spawnRadius[0], simSettings.spawnRadius[1] };
+    int renderer = static_cast<int>(renderMode);
+    glm::vec2 lastCursor = cursorPosition();
+    bool captureKeyDown = false;
+    bool recordingStats = false;
+
+    SCORCH_PROFILE_THREAD("Render");
+
+    try
+    {
+        while (!glfwWindowShouldClose(window))
+        {
+            Profiler::getInstance()->endFrame();
+
+            glfwPollEvents();
+
+            // Takes over the newest simulated frame, and hands the previous instances back to be written over
+            if (simFrames.acquire()) vertInstances.swap(simFrames.readSlot().instances);
+            const SimFrame& simFrame = simFrames.readSlot();
+
+            guiMan->newFrame();
+
+            // Dragging with the right mouse button pans, the wheel zooms around the cursor
+            const glm::vec2 cursor = cursorPosition();
+            if (!ImGui::GetIO().WantCaptureMouse && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
+                camera.pan(cursor - lastCursor);
+            lastCursor = cursor;
+
+            // F9 captures a trace of the next frames
+            const bool captureKey = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+            if (captureKey && !captureKeyDown)
+            {
+#ifdef SCORCH_PROFILING
+                if (!Profiler::getInstance()->isCapturing()) Profiler::getInstance()->startCapture(Profiler::defaultCaptureFrames, "trace.json");
+#else
+                fmt::print(fmterr, "Profiling is compiled out of this build, no trace will be written\n");
+#endif
+            }
+            captureKeyDown = captureKey;
+
+            ImGui::Text("Frame Interval: %.3f \nFPS: %.1f", 1000 / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            ImGui::Text("%.u", static_cast<uint32_t>(vertInstances.size()));
+
+            if (ImGui::Combo("Broadphase", &broadphaseIndex, "Grid\0Incremental Grid\0Hierarchical Grid\0AABB Tree\0Sort and Sweep\0"))
+                simSettings.broadphaseIndex = broadphaseIndex;
+            if (ImGui::Combo("Solver", &solverMode, "Serial\0Coloured\0Jacobi\0"))
+                simSettings.solverMode = static_cast<Physics::SolverMode>(solverMode);
+            // Point sprites larger than a pixel need the largePoints feature
+            if (ImGui::Combo("Renderer", &renderer, "Quads\0Point Sprites\0Density\0"))
+            {
+                if (renderer == static_cast<int>(RenderMode::Points) && !presentMan->largePoints) renderer = static_cast<int>(RenderMode::Quads);
+                renderMode = static_cast<RenderMode>(renderer);
+            }
+
+            // Once even the largest body is smaller than a pixel, counting bodies per pixel shows more than drawing them
+            ImGui::Checkbox("Density LOD", &densityLod);
+            const bool belowPixel = simFrame.maxScale * camera.pixelsPerUnit() < 1.0f;
+            activeRenderMode = densityLod && belowPixel ? RenderMode::Density : renderMode;
+
+            ImGui::Text("Zoom: %.3f", camera.zoom);
+            ImGui::SameLine();
+            if (ImGui::Button("Reset Camera")) camera = Camera{};
+            if (ImGui::SliderFloat2("Spawn Radii", spawnRadius, 0.1f, 2.0f))
+                for (int i = 0; i < 2; i++) simSettings.spawnRadius[i] = spawnRadius[i];
+
+            ImGui::Text("Pairs: %u \nColours: %u", simFrame.pairCount, simFrame.colourCount);
+            if (simFrame.hasMovedCount) ImGui::Text("Moved: %u", simFrame.movedCount);
+
+#ifdef SCORCH_STATS
+            const Physics::FrameStats& stats = simFrame.stats;
+            ImGui::Text("Candidates: %llu \nOverlaps: %llu \nMax Penetration: %.4f", static_cast<unsigned long long>(stats.candidatePairs),
+                        static_cast<unsigned long long>(stats.overlaps), stats.maxPenetration);
+
+            // Cells by how many bodies they hold, empty cells left out so the rest stay readable
+            if (stats.occupancy.size() > 1)
+            {
+                ImGui::PlotHistogram("Occupancy", [](void* data, const int n) { return static_cast<float>(static_cast<const uint32_t*>(data)[n + 1]); },
+                                     const_cast<uint32_t*>(stats.occupancy.data()), static_cast<int>(stats.occupancy.size()) - 1, 0, nullptr, 0.0f, FLT_MAX, { 0.0f, 60.0f });
+            }
+
+            if (ImGui::Checkbox("Record Stats", &recordingStats)) simSettings.recordingStats = recordingStats;
+#endif
+
+            // Switching modes recreates the swap chain, the same way a resize does
+            if (ImGui::BeginCombo("Present Mode", presentModeName(presentMan->presentMode)))
+            {
+                for (size_t i = 0; i < std::size(presentModes); i++)
+                {
+                    const ImGuiSelectableFlags flags = presentMan->supportsPresentMode(presentModes[i]) ? 0 : ImGuiSelectableFlags_Disabled;
+                    if (ImGui::Selectable(presentModeNames[i], presentMan->presentMode == presentModes[i], flags))
+                    {
+                        presentMan->requestedPresentMode = presentModes[i];
+                        presentMan->frameBufferResized = true;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            ImGui::Text("Frames in Flight: %u \nSwap Chain Images: %u", presentMan->framesInFlight, presentMan->imageCount);
+            if (presentMan->presentWait) ImGui::Checkbox("Present Wait", &pacePresents);
+            ImGui::SliderInt("FPS Limit", &frameLimit, 0, 240, frameLimit ? "%d" : "Off");
+
+            simSettings.spawning = ImGui::GetIO().Framerate > 59;
+
+            guiMan->drawProfiler();
+
+            drawFrame();
+            limitFrameRate();
+        }
+    }
+    catch (...) { stopSimulation(); throw; }
+
+    stopSimulation();
+
+    vkDeviceWaitIdle(presentMan->device);
+}
+
+void ScorchV::benchmarkRenderers()
+{
+    constexpr uint32_t sides[] = { 1000, 2236 }; // About a million and five million bodies
+    constexpr uint32_t warmupFrames = 20;
+    constexpr uint32_t timedFrames = 200;
+
+    // Uncapped, so the frame times are the renderers' and not the display's
+    initWindow();
+    presentMan->requestedPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    initVulkan();
+
+    // The bodies fill the view of the default camera. At these counts each one covers less than a pixel, so it is the
+    // per-body work that tells the renderers apart.
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    const glm::vec2 extent = glm::vec2{ static_cast<float>(width), static_cast<float>(height) } / camera.pixelsPerUnit();
+
+    constexpr const char* modeNames[] = { "Quads", "Point Sprites", "Density" };
+
+    fmt::print("Present mode: {}\n", presentModeName(presentMan->presentMode));
+    fmt::print("{:>10} {:>14} {:>12}\n", "Bodies", "Renderer", "ms/frame");
+
+    for (const uint32_t side : sides)
+    {
+        vertInstances.resize(side * side);
+        for (uint32_t i = 0; i < side * side; i++)
+        {
+            const glm::vec2 cell{ (static_cast<float>(i % side) + 0.5f) / side, (static_cast<float>(i / side) + 0.5f) / side };
+            vertInstances[i].modelPos = glm::vec3((cell - 0.5f) * extent, 0.0f);
+            vertInstances[i].scale = 0.8f * extent.x / side;
+        }
+
+        for (const RenderMode mode : { RenderMode::Quads, RenderMode::Points, RenderMode::Density })
+        {
+            if (mode == RenderMode::Points && !presentMan->largePoints)
+            {
+                fmt::print("{:>10} {:>14} {:>12}\n", vertInstances.size(), modeNames[static_cast<int>(mode)], "unsupported");
+                continue;
+            }
+
+            activeRenderMode = mode;
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t frame = 0; frame < warmupFrames + timedFrames; frame++)
+            {
+                if (frame == warmupFrames)
+                {
+                    vkDeviceWaitIdle(presentMan->device);
+                    start = std::chrono::steady_clock::now();
+                }
+
+                glfwPollEvents();
+                guiMan->newFrame();
+                drawFrame();
+            }
+
+            vkDeviceWaitIdle(presentMan->device);
+            const double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / timedFrames;
+
+            fmt::print("{:>10} {:>14} {:>12.3f}\n", vertInstances.size(), modeNames[static_cast<int>(mode)], frameTime);
+        }
+    }
+
+    cleanup();
+}
+
+void ScorchV::renderOffscreen(const uint32_t frames, const std::string& directory, const FrameFormat format, const VkExtent2D extent)
+{
+    offscreen = true;
+    offscreenTarget.directory = directory;
+    offscreenTarget.frameFormat = format;
+    offscreenTarget.extent = extent;
+
+    // No window, so nothing here needs a display
+    initVulkan();
+
+    vertInstances.reserve(100000);
+
+    // Every frame is a step of the same length and spawns a body, so a run comes out the same however fast it renders
+    simSettings.fixedDeltaTime = 1.0f / 60.0f;
+    simSettings.spawning = true;
+
+    simRunning = true;
+    simThread = std::thread(&ScorchV::simulate, this);
+
+    SCORCH_PROFILE_THREAD("Render");
+
+    try
+    {
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            Profiler::getInstance()->endFrame();
+
+            // Waits for the next step rather than drawing one twice
+            while (!simFrames.acquire()) std::this_thread::yield();
+            vertInstances.swap(simFrames.readSlot().instances);
+
+            const SimFrame& simFrame = simFrames.readSlot();
+            activeRenderMode = densityLod && simFrame.maxScale * camera.pixelsPerUnit() < 1.0f ? RenderMode::Density : renderMode;
+
+            drawFrame();
+        }
+    }
+    catch (...) { stopSimulation(); throw; }
+
+    stopSimulation();
+
+    vkDeviceWaitIdle(presentMan->device);
+
+    // The frames still in flight, oldest first
+    for (uint32_t i = 0; i < presentMan->framesInFlight; i++) offscreenTarget.collect((currentFrame + i) % presentMan->framesInFlight);
+
+    cleanup();
+
+    fmt::print("Wrote {} frames to {}\n", frames, directory);
+}
+
+void ScorchV::stopSimulation()
+{
+    simRunning = false;
+    simFrames.acquire(); // Wakes the simulation thread if it is waiting for its last frame to be taken
+    simThread.join();
+}
+
+void ScorchV::simulate()
+{
+    SCORCH_PROFILE_THREAD("Simulation");
+
+    rBodies.reserve(100000);
+
     rbPointers.reserve(100000);
     rbPointers.emplace_back(&rBodies[0]);
 
-    float currTime = 0;
+    uint32_t frameCount = 0;
+    float maxRadius = rBodies[0].radius;
 
     Physics::Grid grid{128, 72, 1};
+    Physics::IncrementalGrid incrementalGrid{128, 72, 1};
+    Physics::HierarchicalGrid hierarchicalGrid{{2 * Physics::boundsX, 2 * Physics::boundsY}};
+    Physics::AABBTree aabbTree;
+    Physics::SortAndSweep sortAndSweep;
+    Physics::Broadphase* broadphases[] = { &grid, &incrementalGrid, &hierarchicalGrid, &aabbTree, &sortAndSweep };
 
-    while (!glfwWindowShouldClose(window))
-    {
-        glfwPollEvents();
+    Physics::ContactSolver contactSolver;
 
-        const float prevTime = currTime;
-        currTime = static_cast<float>(glfwGetTime());
-        const float deltaTime = currTime - prevTime;
+#ifdef SCORCH_STATS
+    // Kept in memory while recording, and written out when it stops
+    std::vector<Physics::FrameStats> recordedStats;
+    bool recordingStats = false;
+#endif
 
-        if (ImGui::GetIO().Framerate > 59)
+    auto prevTime = std::chrono::steady_clock::now();
+
+    while (simRunning)
+    {
+        const auto currTime = std::chrono::steady_clock::now();
+        const float fixedDeltaTime = simSettings.fixedDeltaTime;
+        const float deltaTime = fixedDeltaTime > 0.0f ? fixedDeltaTime : std::chrono::duration<float>(currTime - prevTime).count();
+        prevTime = currTime;
+
+        // rbPointers point into rBodies, which must never reallocate under them
+        if (simSettings.spawning && rBodies.size() < rBodies.capacity())
         {
-            RigidBody newBody{ { 0.00f, 30.0f}, { -0.1f, 30.0f} };
+            // Alternates between the two spawn radii so mixed sizes can be tried out from the GUI
+            RigidBody newBody{ { 0.00f, 30.0f}, { -0.1f, 30.0f}, 0, simSettings.spawnRadius[rBodies.size() % 2] };
             rBodies.emplace_back(newBody);
             rbPointers.emplace_back(&rBodies.back());
+            maxRadius = std::max(maxRadius, newBody.radius);
         }
 
-        Physics::Update(rbPointers, grid, deltaTime);
+        if (++frameCount % Physics::MortonOrder::reorderInterval == 0) SortBodies();
 
-        guiMan->newFrame();
+        Physics::Broadphase* broadphase = broadphases[simSettings.broadphaseIndex];
+        contactSolver.mode = simSettings.solverMode;
 
-        ImGui::Text("Frame Interval: %.3f \nFPS: %.1f", 1000 / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
-        ImGui::Text("%.u", static_cast<uint32_t>(rBodies.size()));
+        Physics::Update(rbPointers, *broadphase, contactSolver, deltaTime);
 
-        drawFrame();
+        {
+            SCORCH_PROFILE_SCOPE("Publish Instances");
+
+            SimFrame& frame = simFrames.writeSlot();
+            frame.instances.resize(rBodies.size());
+
+            jobSystem->parallelFor(static_cast<uint32_t>(rBodies.size()), instancesPerJob, [&](const uint32_t first, const uint32_t last)
+            {
+                for (uint32_t i = first; i < last; i++)
+                {
+                    frame.instances[i].modelPos = glm::vec3(rBodies[i].currPos, 0.0f);
+                    frame.instances[i].scale = 2.0f * rBodies[i].radius;
+                }
+            });
+
+            frame.pairCount = contactSolver.getPairCount();
+            frame.colourCount = contactSolver.getColourCount();
+            frame.hasMovedCount = broadphase == &incrementalGrid;
+            frame.movedCount = incrementalGrid.getMovedCount();
+            frame.maxScale = 2.0f * maxRadius;
+
+#ifdef SCORCH_STATS
+            Physics::PhysicsStats::getInstance()->endFrame(*broadphase, frame.stats);
+
+            const bool recording = simSettings.recordingStats;
+            if (recording) recordedStats.push_back(frame.stats);
+            else if (recordingStats)
+            {
+                Physics::PhysicsStats::writeCsv(statsPath, recordedStats);
+                recordedStats.clear();
+            }
+            recordingStats = recording;
+#endif
+
+            simFrames.publish();
+        }
+
+        // Stay one frame ahead of the renderer rather than simulating frames that are never drawn
+        {
+            SCORCH_PROFILE_SCOPE("Wait For Renderer");
+            simFrames.waitUntilTaken(simRunning);
+        }
     }
 
-    vkDeviceWaitIdle(presentMan->device);
+#ifdef SCORCH_STATS
+    if (recordingStats) Physics::PhysicsStats::writeCsv(statsPath, recordedStats);
+#endif
 }
 
 void ScorchV::cleanup()
 {
+    jobSystem->shutdown();
+    Profiler::getInstance()->shutdown();
+
     presentMan->cleanupSwapChain();
-    guiMan->destroyImGui();
+    if (offscreen) offscreenTarget.destroyTarget();
+    else guiMan->destroyImGui();
 
     bufferMan->destroyUniformBuffers();
+    culler.destroyVisibleBuffers();
+    culler.destroyCuller();
+    splatter.destroyImages();
+    splatter.destroySplatter();
+    gpuTimer.destroyTimer();
+
     bufferMan->destroyInstanceBuffers();
+
+    // The device is idle, nothing retired is in use any more
+    deletionQueue->flushAll();
+
     bufferMan->destroyResourceDescriptor();
     bufferMan->destroyBufferManager();
 
+    vkDestroyPipeline(presentMan->device, densityPipeline, nullptr);
+    vkDestroyPipelineLayout(presentMan->device, densityPipelineLayout, nullptr);
+    vkDestroyPipeline(presentMan->device, pointPipeline, nullptr);
+    vkDestroyPipelineLayout(presentMan->device, pointPipelineLayout, nullptr);
     vkDestroyPipeline(presentMan->device, graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(presentMan->device, pipelineLayout, nullptr);
 
-    vkDestroyRenderPass(presentMan->device, renderPass, nullptr);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
     {
         vkDestroySemaphore(presentMan->device, imageAvailableSemaphores[i], nullptr);
         vkDestroySemaphore(presentMan->device, renderFinishedSemaphores[i], nullptr);
         vkDestroyFence(presentMan->device, inFlightFences[i], nullptr);
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        vkDestroyCommandPool(presentMan->device, commandPools[i], nullptr);
+    for (const std::vector<VkCommandPool>& framePools : commandPools)
+        for (VkCommandPool commandPool : framePools) vkDestroyCommandPool(presentMan->device, commandPool, nullptr);
 
     presentMan->destroyPresentation(instance);
 
@@ -95,8 +491,11 @@ void ScorchV::cleanup()
 
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (window)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void ScorchV::createInstance()
@@ -121,61 +520,64 @@ void ScorchV::createInstance()
         throw std::runtime_error("Failed to create instance!");
 }
 
-void ScorchV::createRenderPass()
-{
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = presentMan->swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(presentMan->device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create render pass!");
-}
-
 void ScorchV::createGraphicsPipeline()
 {
-    Shader shader{"../res/spir-v/vert.spv", "../res/spir-v/circleFrag.spv"};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &bufferMan->descriptorSetLayout;
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(ViewConstants);
+
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(presentMan->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create pipeline layout!");
 
-    std::vector<VkVertexInputBindingDescription> bindingDescription = {Vertex::getBindingDescription(), VertexInstance::getBindingDescription()};
     std::vector<VkVertexInputAttributeDescription> attributeDescription;
 
     for (auto attrib : Vertex::getAttributeDescription()) attributeDescription.push_back(attrib);
     for (auto attrib : VertexInstance::getAttributeDescription()) attributeDescription.push_back(attrib);
 
+    Shader shader{"../res/spir-v/vert.spv", "../res/spir-v/circleFrag.spv"};
+    createPipeline(shader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, {Vertex::getBindingDescription(), VertexInstance::getBindingDescription()},
+                   attributeDescription, pipelineLayout, graphicsPipeline);
+    shader.destroyShader();
+
+    // Point sprites only read the instances, one per vertex
+    pushConstantRange.size = sizeof(PointConstants);
+
+    if (vkCreatePipelineLayout(presentMan->device, &pipelineLayoutInfo, nullptr, &pointPipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create point pipeline layout!");
+
+    Shader pointShader{"../res/spir-v/pointVert.spv", "../res/spir-v/pointFrag.spv"};
+    createPipeline(pointShader, VK_PRIMITIVE_TOPOLOGY_POINT_LIST, {VertexInstance::getBindingDescription(VK_VERTEX_INPUT_RATE_VERTEX)},
+                   VertexInstance::getAttributeDescription(), pointPipelineLayout, pointPipeline);
+    pointShader.destroyShader();
+
+    // The density pass draws a single full screen triangle that reads the splatted image
+    pipelineLayoutInfo.pSetLayouts = &splatter.descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+    if (vkCreatePipelineLayout(presentMan->device, &pipelineLayoutInfo, nullptr, &densityPipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create density pipeline layout!");
+
+    Shader densityShader{"../res/spir-v/densityVert.spv", "../res/spir-v/densityFrag.spv"};
+    createPipeline(densityShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, {}, {}, densityPipelineLayout, densityPipeline);
+    densityShader.destroyShader();
+}
+
+void ScorchV::createPipeline(const Shader& shader, const VkPrimitiveTopology topology, const std::vector<VkVertexInputBindingDescription>& bindingDescription,
+                             const std::vector<VkVertexInputAttributeDescription>& attributeDescription, VkPipelineLayout layout, VkPipeline& pipeline)
+{
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
     vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
     vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
@@ -183,7 +585,7 @@ void ScorchV::createGraphicsPipeline()
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.topology = topology;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
     VkPipelineViewportStateCreateInfo viewportState{};
@@ -237,19 +639,16 @@ void ScorchV::createGraphicsPipeline()
     dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
     dynamicState.pDynamicStates = dynamicStates.data();
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &bufferMan->descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if (vkCreatePipelineLayout(presentMan->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create pipeline layout!");
+    // Built for the attachment format rather than a render pass
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &presentMan->swapChainImageFormat;
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
+    pipelineInfo.pNext = &renderingInfo;
+    pipelineInfo.stageCount = shader.stageCount;
     pipelineInfo.pStages = shader.shaderStages;
 
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -260,45 +659,66 @@ void ScorchV::createGraphicsPipeline()
     pipelineInfo.pDepthStencilState = nullptr;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = VK_NULL_HANDLE;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(presentMan->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(presentMan->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
         throw std::runtime_error("Failed to create graphics pipeline!");
-
-    shader.destroyShader();
 }
 
 void ScorchV::createCommandPools()
 {
-    commandPools.resize(MAX_FRAMES_IN_FLIGHT);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        createVkCommandPool(commandPools[i], VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    // A pool must never be used from two threads at once, so every pass gets its own rather than sharing by thread:
+    // any thread may pick up a recording job, including one that is only helping out while it waits
+    commandPools.resize(presentMan->framesInFlight);
+    for (std::vector<VkCommandPool>& framePools : commandPools)
+    {
+        framePools.resize(1 + passCount);
+        for (VkCommandPool& commandPool : framePools) createVkCommandPool(commandPool, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
 }
 
 void ScorchV::createCommandBuffers()
 {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    commandBuffers.resize(presentMan->framesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     allocInfo.commandBufferCount = 1;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
     {
-        allocInfo.commandPool = commandPools[i];
+        allocInfo.commandPool = commandPools[i][0];
 
         if (vkAllocateCommandBuffers(presentMan->device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS)
             throw std::runtime_error("Failed to allocate command buffers!");
     }
+
+    secondaryCommandBuffers.resize(presentMan->framesInFlight);
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
+    {
+        secondaryCommandBuffers[i].resize(passCount);
+
+        for (uint32_t pass = 0; pass < passCount; pass++)
+        {
+            allocInfo.commandPool = commandPools[i][1 + pass];
+
+            if (vkAllocateCommandBuffers(presentMan->device, &allocInfo, &secondaryCommandBuffers[i][pass]) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate secondary command buffers!");
+        }
+    }
 }
 
-void ScorchV::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+void ScorchV::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<VkCommandBuffer>& secondaries)
 {
+    SCORCH_PROFILE_SCOPE("recordCommandBuffer");
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -307,21 +727,113 @@ void ScorchV::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageI
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
         throw std::runtime_error("Failed to begin recording command buffer!");
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = presentMan->swapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = presentMan->swapChainExtent;
+    gpuTimer.reset(commandBuffer, currentFrame);
+
+    gpuTimer.begin(commandBuffer, currentFrame, GpuPass::Compute);
+    if (activeRenderMode == RenderMode::Density) splatter.recordSplat(commandBuffer, currentFrame);
+    else culler.recordCull(commandBuffer, currentFrame);
+    gpuTimer.end(commandBuffer, currentFrame, GpuPass::Compute);
+
+    const VkImage targetImage = offscreen ? offscreenTarget.getImage(currentFrame) : presentMan->swapChainImages[imageIndex];
+    const VkImageView targetView = offscreen ? offscreenTarget.getImageView(currentFrame) : presentMan->swapChainImageViews[imageIndex];
+
+    // Cleared anyway, so the old contents can go. On screen the acquire semaphore is waited on at the attachment output
+    // stage, which the transition waits for in turn.
+    transitionImage(commandBuffer, targetImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE,
+                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+    VkRenderingAttachmentInfo colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = targetView;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = { { {0.0f, 0.0f, 0.0f, 1.0f} } };
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = presentMan->swapChainExtent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+    // There is no GUI offscreen, only the scene pass is recorded
+    vkCmdExecuteCommands(commandBuffer, offscreen ? 1 : static_cast<uint32_t>(secondaries.size()), secondaries.data());
+
+    vkCmdEndRendering(commandBuffer);
+
+    // Offscreen, the frame is copied out to be read back rather than presented. The present waits on the render
+    // finished semaphore, which covers everything in the submission, so nothing has to wait on the transition to it.
+    if (offscreen)
+        transitionImage(commandBuffer, targetImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+    else
+        transitionImage(commandBuffer, targetImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE);
+
+    if (offscreen)
+    {
+        // The GUI pass still gets its timestamps, or the frame's queries would never all be available
+        gpuTimer.begin(commandBuffer, currentFrame, GpuPass::Gui);
+        gpuTimer.end(commandBuffer, currentFrame, GpuPass::Gui);
+
+        offscreenTarget.recordReadback(commandBuffer, currentFrame);
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record command buffer!");
+}
+
+void ScorchV::recordSecondary(SecondaryPass& pass, const uint32_t passIndex)
+{
+    try
+    {
+        VkCommandBuffer commandBuffer = secondaryCommandBuffers[currentFrame][passIndex];
+
+        // Only the attachment formats are inherited, so recording does not depend on which image is drawn to
+        VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &presentMan->swapChainImageFormat;
+        renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.pNext = &renderingInfo;
 
-    constexpr VkClearValue clearColor = { { {0.0f, 0.0f, 0.0f, 1.0f} } };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin recording secondary command buffer!");
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        (this->*pass.record)(commandBuffer);
 
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record secondary command buffer!");
+    }
+    catch (...) { pass.error = std::current_exception(); }
+}
+
+void ScorchV::recordScene(VkCommandBuffer commandBuffer)
+{
+    SCORCH_PROFILE_SCOPE("recordScene");
+
+    gpuTimer.begin(commandBuffer, currentFrame, GpuPass::Scene);
+
+    const VkPipeline pipelines[] = { graphicsPipeline, pointPipeline, densityPipeline };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[static_cast<int>(activeRenderMode)]);
+
+    // Dynamic state is not inherited from the primary buffer
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -336,21 +848,50 @@ void ScorchV::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageI
     scissor.extent = presentMan->swapChainExtent;
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    mesh.draw(commandBuffer, vertInstances.size(), pipelineLayout, currentFrame);
+    switch (activeRenderMode)
+    {
+    case RenderMode::Quads:
+    {
+        const ViewConstants constants{ viewProj };
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
 
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+        mesh.draw(commandBuffer, culler, pipelineLayout, currentFrame);
+        break;
+    }
 
-    vkCmdEndRenderPass(commandBuffer);
+    case RenderMode::Points:
+    {
+        const PointConstants constants{ viewProj, { viewport.width, viewport.height }, presentMan->maxPointSize };
+        vkCmdPushConstants(commandBuffer, pointPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
 
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-        throw std::runtime_error("Failed to record command buffer!");
+        mesh.drawPoints(commandBuffer, culler, pointPipelineLayout, currentFrame);
+        break;
+    }
+
+    case RenderMode::Density:
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, densityPipelineLayout, 0, 1, &splatter.descriptorSets[currentFrame], 0, nullptr);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        break;
+    }
+
+    gpuTimer.end(commandBuffer, currentFrame, GpuPass::Scene);
+}
+
+void ScorchV::recordGui(VkCommandBuffer commandBuffer)
+{
+    SCORCH_PROFILE_SCOPE("recordGui");
+
+    gpuTimer.begin(commandBuffer, currentFrame, GpuPass::Gui);
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    gpuTimer.end(commandBuffer, currentFrame, GpuPass::Gui);
 }
 
 void ScorchV::createSyncObjects()
 {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(presentMan->framesInFlight);
+    renderFinishedSemaphores.resize(presentMan->framesInFlight);
+    inFlightFences.resize(presentMan->framesInFlight);
+    frameNumbers.assign(presentMan->framesInFlight, 0);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -359,7 +900,7 @@ void ScorchV::createSyncObjects()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < presentMan->framesInFlight; i++)
     {
         if (vkCreateSemaphore(presentMan->device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(presentMan->device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
@@ -368,47 +909,120 @@ void ScorchV::createSyncObjects()
     }
 }
 
+// The view only changes with the camera or the swap chain, so that is the only time the UBO and viewProj are rebuilt
+void ScorchV::updateView()
+{
+    const VkExtent2D extent = presentMan->swapChainExtent;
+    if (camera == viewCamera && extent.width == viewExtent.width && extent.height == viewExtent.height) return;
+
+    viewCamera = camera;
+    viewExtent = extent;
+
+    UniformBufferObject ubo{};
+    ubo.model = glm::mat4(1.0f);
+    ubo.view = camera.view();
+    ubo.proj = camera.projection(static_cast<float>(extent.width), static_cast<float>(extent.height));
+
+    viewProj = ubo.proj * ubo.view;
+    bufferMan->setUniformBufferObject(ubo);
+}
+
+// Sleeps most of the way to the next frame and yields for the rest, since a sleep can overshoot by a millisecond or more
+void ScorchV::limitFrameRate()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    if (frameLimit <= 0)
+    {
+        nextFrameTime = now;
+        return;
+    }
+
+    SCORCH_PROFILE_SCOPE("Frame Limiter");
+
+    // A frame that ran late pushes the next ones back rather than being caught up on
+    nextFrameTime = std::max(nextFrameTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / frameLimit)), now);
+
+    constexpr auto sleepMargin = std::chrono::milliseconds(2);
+    if (nextFrameTime - now > sleepMargin) std::this_thread::sleep_until(nextFrameTime - sleepMargin);
+    while (std::chrono::steady_clock::now() < nextFrameTime) std::this_thread::yield();
+}
+
 void ScorchV::drawFrame()
 {
-    vkWaitForFences(presentMan->device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    SCORCH_PROFILE_SCOPE("drawFrame");
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(presentMan->device, presentMan->swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    // With present wait the frame starts once the one before last is on screen, rather than queueing up behind it
+    if (pacePresents)
+    {
+        SCORCH_PROFILE_SCOPE("vkWaitForPresentKHR");
+        presentMan->waitForPresent(presentWaitLag);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) { presentMan->recreateSwapChain(renderPass); return; }
+    {
+        SCORCH_PROFILE_SCOPE("vkWaitForFences");
+        vkWaitForFences(presentMan->device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    // The queries and the readback of this frame in flight are done with once its fence has signalled, and so is
+    // everything retired before it was submitted
+    deletionQueue->flush(frameNumbers[currentFrame]);
+    presentMan->releaseRetired();
+    gpuTimer.collect(currentFrame);
+    if (offscreen) offscreenTarget.collect(currentFrame);
+
+    // Offscreen there is nothing to acquire, every frame in flight has an image of its own
+    uint32_t imageIndex = currentFrame;
+    VkResult result = VK_SUCCESS;
+    if (!offscreen) result = vkAcquireNextImageKHR(presentMan->device, presentMan->swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) { presentMan->recreateSwapChain(); return; }
 
     if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
         throw std::runtime_error("Failed to acquire swap chain image!");
 
-    if (vertInstances.size() != rBodies.size())
     {
-        vertInstances.resize(rBodies.size());
+        SCORCH_PROFILE_SCOPE("Resize Frame Resources");
+
+        // Only this frame's buffers and images are replaced, the old ones go on the deletion queue. The other frames
+        // in flight catch up when they come around, so nothing waits on the device.
+        const uint32_t instanceCount = static_cast<uint32_t>(vertInstances.size());
+        const bool instanceBufferChanged = bufferMan->reserveInstanceBuffer(currentFrame, instanceCount);
+        culler.setInstances(currentFrame, instanceCount, instanceBufferChanged);
+        splatter.setInstances(currentFrame, instanceCount, instanceBufferChanged);
+        splatter.setExtent(currentFrame, presentMan->swapChainExtent);
+    }
 
-        vkDeviceWaitIdle(presentMan->device);
+    vkResetFences(presentMan->device, 1, &inFlightFences[currentFrame]);
 
-        bufferMan->destroyInstanceBuffers();
-        bufferMan->createInstanceBuffers(vertInstances, commandPools[0], graphicsQueue);
-    }
+    for (VkCommandPool commandPool : commandPools[currentFrame]) vkResetCommandPool(presentMan->device, commandPool, 0);
 
-    for (size_t i = 0; i < rBodies.size(); i++) vertInstances[i].modelPos = glm::vec3(rBodies[i].currPos, 0.0f);
+    if (!offscreen) guiMan->renderGui();
+    updateView();
 
-    bufferMan->updateInstanceBuffers(vertInstances);
-    bufferMan->updateUniformBuffers(window, currentFrame);
+    // Every pass records into its own secondary buffer on the job system, while this thread uploads the instances
+    SecondaryPass passes[passCount] = { { &ScorchV::recordScene }, { &ScorchV::recordGui } };
+    JobCounter recording;
 
-    vkResetFences(presentMan->device, 1, &inFlightFences[currentFrame]);
+    auto recordScenePass = [&] { recordSecondary(passes[0], 0); };
+    auto recordGuiPass = [&] { recordSecondary(passes[1], 1); };
+    jobSystem->run(recordScenePass, recording);
+    if (!offscreen) jobSystem->run(recordGuiPass, recording);
 
-    vkResetCommandPool(presentMan->device, commandPools[currentFrame], 0);
+    bufferMan->updateInstanceBuffers(vertInstances, currentFrame);
+    bufferMan->updateUniformBuffers(currentFrame);
 
-    guiMan->renderGui();
+    jobSystem->wait(recording);
+    for (const SecondaryPass& pass : passes) if (pass.error) std::rethrow_exception(pass.error);
 
-    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+    recordCommandBuffer(commandBuffers[currentFrame], imageIndex, secondaryCommandBuffers[currentFrame]);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     const VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
     constexpr VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = offscreen ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -416,33 +1030,32 @@ void ScorchV::drawFrame()
     submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
     const VkSemaphore signalSemaphores[] { renderFinishedSemaphores[currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = offscreen ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
         throw std::runtime_error("Failed to submit the draw command buffer!");
 
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    frameNumbers[currentFrame] = deletionQueue->frameSubmitted();
 
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-
-    const VkSwapchainKHR swapChains[] = { presentMan->swapChain };
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-
-    presentInfo.pImageIndices = &imageIndex;
+    if (offscreen)
+    {
+        currentFrame = (currentFrame + 1) % presentMan->framesInFlight;
+        return;
+    }
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        SCORCH_PROFILE_SCOPE("vkQueuePresentKHR");
+        result = presentMan->present(presentQueue, renderFinishedSemaphores[currentFrame], imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || presentMan->frameBufferResized)
     {
         presentMan->frameBufferResized = false;
-        presentMan->recreateSwapChain(renderPass);
+        presentMan->recreateSwapChain();
     }
     else if (result != VK_SUCCESS)
         throw std::runtime_error("Failed to present swap chain image!");
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % presentMan->framesInFlight;
 }
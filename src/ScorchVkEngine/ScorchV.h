@@ -5,15 +5,76 @@
 
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <chrono>
 
 #include <GLFW/glfw3.h>
 
 #include <Abstractions/ValidationLayers.h>
 #include <Abstractions/PresentationManager.h>
 #include <Abstractions/Rendering/BufferManager.h>
+#include <Abstractions/Rendering/InstanceCuller.h>
+#include <Abstractions/Rendering/DensitySplatter.h>
+#include <Abstractions/Rendering/GpuTimer.h>
+#include <Abstractions/Rendering/OffscreenTarget.h>
+#include <Abstractions/Rendering/Camera.h>
+#include <Abstractions/Rendering/Shader.h>
 #include <Abstractions/Rendering/Objects/MeshObject.h>
 #include <Abstractions/Rendering/Objects/PhysicsHeader.h>
 #include <Abstractions/GuiManager.h>
+#include <Abstractions/JobSystem.h>
+#include <Abstractions/DeletionQueue.h>
+#include <Abstractions/Profiler.h>
+#include <Abstractions/TripleBuffer.h>
+
+// What the simulation thread hands over to the render thread every frame
+struct SimFrame
+{
+    std::vector<VertexInstance> instances;
+
+    uint32_t pairCount = 0;
+    uint32_t colourCount = 0;
+    uint32_t movedCount = 0;
+    bool hasMovedCount = false;
+
+    float maxScale = 2.0f * rad; // Diameter of the largest body
+
+    Physics::FrameStats stats;
+};
+
+// Set from the GUI on the render thread, read by the simulation thread every frame
+struct SimSettings
+{
+    std::atomic<int> broadphaseIndex{1};
+    std::atomic<Physics::SolverMode> solverMode{Physics::SolverMode::Coloured};
+    std::atomic<float> spawnRadius[2] = { rad, rad };
+    std::atomic<bool> spawning{false};
+    std::atomic<bool> recordingStats{false}; // Written out as CSV once it goes back to false
+    std::atomic<float> fixedDeltaTime{0.0f}; // Steps by this rather than by the time taken, when not zero
+};
+
+enum class RenderMode : int
+{
+    Quads,  // Four vertices and six indices per body, masked to a circle
+    Points, // One point sprite per body, masked the same way with gl_PointCoord
+    Density // Bodies counted per pixel by a compute pass, for when they are smaller than a pixel
+};
+
+// Pushed to shader.vert, so the view can change without touching the UBO
+struct ViewConstants
+{
+    glm::mat4 viewProj;
+};
+
+// Pushed to point.vert, which also needs the viewport to turn a body's diameter into a point size
+struct PointConstants
+{
+    glm::mat4 viewProj;
+    glm::vec2 viewportSize;
+    float maxPointSize;
+};
 
 class ScorchV
 {
@@ -26,6 +87,12 @@ public:
         cleanup();
     }
 
+    // Draws a fixed scene with every renderer in turn and prints the frame times, without simulating anything
+    void benchmarkRenderers();
+
+    // Simulates and renders the given number of frames without a window, writing every one of them into directory
+    void renderOffscreen(uint32_t frames, const std::string& directory, FrameFormat format, VkExtent2D extent);
+
     bool frameBufferResized = false;
 
 private:
@@ -39,57 +106,107 @@ private:
     QueueFamilyIndices _indices;
 
     MeshObject mesh;
+    InstanceCuller culler;
+    DensitySplatter splatter;
+    GpuTimer gpuTimer;
+
+    // Renders into offscreenTarget instead of the swap chain, with no window and no GUI
+    bool offscreen = false;
+    OffscreenTarget offscreenTarget;
+
+    Camera camera;
+
+    // The camera and extent the UBO and viewProj were last built for. A zero extent never matches, so the first frame
+    // always builds them.
+    Camera viewCamera;
+    VkExtent2D viewExtent{};
+    glm::mat4 viewProj{1.0f};
+
+    // Only touched by the simulation thread while it runs
     std::vector<RigidBody> rBodies = { { {0.00f, 30.0f}, {-0.1f, 30.0f} } };
     std::vector<RigidBody*> rbPointers;
+    Physics::MortonOrder bodyOrder{{2 * Physics::boundsX, 2 * Physics::boundsY}};
+
+    std::thread simThread;
+    std::atomic<bool> simRunning{false};
+    SimSettings simSettings;
+    TripleBuffer<SimFrame> simFrames;
 
     std::vector<VertexInstance> vertInstances{1};
 
     VkQueue graphicsQueue{};
     VkQueue presentQueue{};
 
-    VkRenderPass renderPass{};
-
     VkPipelineLayout pipelineLayout{};
     VkPipeline graphicsPipeline{};
-
-    std::vector<VkCommandPool> commandPools{};
+    VkPipelineLayout pointPipelineLayout{};
+    VkPipeline pointPipeline{};
+    VkPipelineLayout densityPipelineLayout{};
+    VkPipeline densityPipeline{};
+    RenderMode renderMode = RenderMode::Quads;
+    RenderMode activeRenderMode = RenderMode::Quads; // What this frame is drawn with, after the level of detail switch
+    bool densityLod = true;
+
+    static constexpr uint64_t presentWaitLag = 1; // Presents left queued when a frame starts
+    bool pacePresents = false;
+    int frameLimit = 0; // Frames per second, zero for none
+    std::chrono::steady_clock::time_point nextFrameTime;
+
+    // Per frame in flight: the render thread's pool for the primary buffer, then one per pass recorded on the job system
+    std::vector<std::vector<VkCommandPool>> commandPools{};
 
     BufferManager* bufferMan = BufferManager::getInstance();
 
     GuiManager* guiMan = GuiManager::getInstance();
 
+    JobSystem* jobSystem = JobSystem::getInstance();
+
+    DeletionQueue* deletionQueue = DeletionQueue::getInstance();
+
     std::vector<VkCommandBuffer> commandBuffers;
+    std::vector<std::vector<VkCommandBuffer>> secondaryCommandBuffers; // Per frame in flight, one per pass
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
+    std::vector<uint64_t> frameNumbers; // What the deletion queue numbered the last frame submitted in each slot
     uint32_t currentFrame = 0;
 
     #pragma endregion
 
     void initWindow();
+    static void scrollCallback(GLFWwindow* window, double xOffset, double yOffset);
+    glm::vec2 cursorPosition() const; // In framebuffer pixels
 
     void initVulkan()
     {
         createInstance();
         vLayers.setupDebugMessenger(instance);
-        presentMan->setUpPresentation(instance, window, vLayers, graphicsQueue, presentQueue);
-        createRenderPass();
+        if (offscreen) presentMan->setUpHeadless(instance, vLayers, graphicsQueue, offscreenTarget.extent, OffscreenTarget::format);
+        else presentMan->setUpPresentation(instance, window, vLayers, graphicsQueue, presentQueue);
         bufferMan->createDescriptorSetLayout();
+        splatter.createSplatter();
         createGraphicsPipeline();
-        presentMan->createFramebuffers(renderPass);
+        if (offscreen) offscreenTarget.createTarget();
         createCommandPools();
-        bufferMan->setUpBufferManager(instance, mesh.vertices, mesh.indices, vertInstances, commandPools[0], graphicsQueue);
+        bufferMan->setUpBufferManager(instance, mesh.vertices, mesh.indices, vertInstances, commandPools[0][0], graphicsQueue);
+        culler.createCuller(static_cast<uint32_t>(mesh.indices.size()));
+        culler.createVisibleBuffers(static_cast<uint32_t>(vertInstances.size()));
+        splatter.createImages(presentMan->swapChainExtent);
         createCommandBuffers();
         createSyncObjects();
-        guiMan->setupImGui(instance, window, graphicsQueue, renderPass);
+        gpuTimer.createTimer();
+        if (!offscreen) guiMan->setupImGui(instance, window, graphicsQueue);
     }
     void mainLoop();
+    void simulate();
+    void stopSimulation();
     void cleanup();
 
     void createInstance();
-    void createRenderPass();
     void createGraphicsPipeline();
+    void createPipeline(const Shader& shader, VkPrimitiveTopology topology, const std::vector<VkVertexInputBindingDescription>& bindingDescription,
+                        const std::vector<VkVertexInputAttributeDescription>& attributeDescription, VkPipelineLayout layout, VkPipeline& pipeline);
     void createCommandPools();
 
     void createVkCommandPool(VkCommandPool& commandPool, VkCommandPoolCreateFlags flags)
@@ -105,13 +222,25 @@ private:
             throw std::runtime_error("Failed to create the command pool!");
     }
 
-    void SortBodies()
-    {
-        std::sort(rBodies.begin(), rBodies.end(), [](RigidBody& b1, RigidBody& b2) { return b1.currPos.x < b2.currPos.x; });
-    }
+    // Z-orders the body values in place, rbPointers[i] keeps pointing at rBodies[i]
+    void SortBodies() { bodyOrder.reorder(rbPointers); }
 
     void createCommandBuffers();
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<VkCommandBuffer>& secondaries);
+
+    // Records one pass into its secondary buffer, from whichever thread picks up the job
+    struct SecondaryPass
+    {
+        void (ScorchV::*record)(VkCommandBuffer commandBuffer);
+        std::exception_ptr error;
+    };
+    static constexpr uint32_t passCount = 2;
+
+    void recordSecondary(SecondaryPass& pass, uint32_t passIndex);
+    void recordScene(VkCommandBuffer commandBuffer);
+    void recordGui(VkCommandBuffer commandBuffer);
     void createSyncObjects();
+    void updateView();
+    void limitFrameRate();
     void drawFrame();
 };
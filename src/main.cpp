@@ -1,9 +1,95 @@
 #define FMT_HEADER_ONLY
 
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
 #include <fmt/core.h>
 #include <ScorchV.h>
+#include <Abstractions/Benchmark.h>
+
+namespace
+{
+    // Parses the number given to option and clamps it to [min, max] while it is still an unsigned long, so values past
+    // uint32_t cannot wrap around when narrowed. std::stoul would take a sign and wrap negative numbers around as well,
+    // so only plain digits are accepted.
+    uint32_t parseCount(const char* option, const std::string& value, const uint32_t min, const uint32_t max)
+    {
+        if (value.empty() || !std::all_of(value.begin(), value.end(), [](const unsigned char c) { return std::isdigit(c); }))
+            throw std::runtime_error(fmt::format("{} expects a number, not \"{}\"\n", option, value));
+
+        unsigned long count;
+        try { count = std::stoul(value); }
+        catch (const std::out_of_range&) { count = std::numeric_limits<unsigned long>::max(); }
+
+        return static_cast<uint32_t>(std::clamp<unsigned long>(count, min, max));
+    }
+
+    constexpr uint32_t maxCount = std::numeric_limits<uint32_t>::max();
+    constexpr uint32_t maxExtent = 16384; // The largest 2D image most devices support
+}
+
+int main(int argc, char* argv[]) {
+    // `--frames-in-flight <n>` and `--swapchain-images <n>` go with any of the modes below, and are taken out of the
+    // arguments before those look at them
+    PresentationManager* presentMan = PresentationManager::getInstance();
+    int kept = 1;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--frames-in-flight" && i + 1 < argc)
+                presentMan->framesInFlight = parseCount("--frames-in-flight", argv[++i], 1, PresentationManager::maxFramesInFlight);
+            else if (arg == "--swapchain-images" && i + 1 < argc)
+                presentMan->requestedImageCount = parseCount("--swapchain-images", argv[++i], 1, PresentationManager::maxRequestedImageCount);
+            else argv[kept++] = argv[i];
+        }
+    }
+    catch (const std::exception& e) { fmt::print(fmterr, "{}", e.what()); return EXIT_FAILURE; }
+    argc = kept;
+
+    if (argc > 2 && std::string(argv[1]) == "--bench")
+    {
+        try { if (Benchmark::run(argv[2])) return EXIT_SUCCESS; }
+        catch (const std::exception& e) { fmt::print(fmterr, "{}", e.what()); return EXIT_FAILURE; }
+
+        fmt::print(fmterr, "Unknown benchmark: {}\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    // `ScorchV --trace <frames> [path]` writes a Chrome trace of the first frames, F9 does the same while running
+    if (argc > 2 && std::string(argv[1]) == "--trace")
+    {
+#ifdef SCORCH_PROFILING
+        try { Profiler::getInstance()->startCapture(parseCount("--trace", argv[2], 1, maxCount), argc > 3 ? argv[3] : "trace.json"); }
+        catch (const std::exception& e) { fmt::print(fmterr, "{}", e.what()); return EXIT_FAILURE; }
+#else
+        fmt::print(fmterr, "Profiling is compiled out of this build, no trace will be written\n");
+#endif
+    }
+
+    // `ScorchV --offscreen <frames> [directory] [png|raw] [width height]` renders without a window and writes every frame
+    if (argc > 2 && std::string(argv[1]) == "--offscreen")
+    {
+        const std::string directory = argc > 3 ? argv[3] : "frames";
+        const FrameFormat format = argc > 4 && std::string(argv[4]) == "raw" ? FrameFormat::Raw : FrameFormat::Png;
+
+        try
+        {
+            const uint32_t frames = parseCount("--offscreen", argv[2], 1, maxCount);
+            VkExtent2D extent = { 1920, 1080 };
+            if (argc > 6) extent = { parseCount("--offscreen width", argv[5], 1, maxExtent), parseCount("--offscreen height", argv[6], 1, maxExtent) };
+
+            ScorchV app;
+            app.renderOffscreen(frames, directory, format, extent);
+        }
+        catch (const std::exception& e) { fmt::print(fmterr, "{}", e.what()); return EXIT_FAILURE; }
+
+        return EXIT_SUCCESS;
+    }
 
-int main() {
     ScorchV app;
 
     try { app.run(); }